@@ -0,0 +1,133 @@
+/* -*- c++ -*- */
+/*
+ *  Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ Microbenchmark of the wire path kernels (lib/kernels.h).
+
+ Every kernel is timed against its scalar _generic version on one window-sized segment of samples.
+ Set GR_ROUTER_SIMD=generic|sse2|avx2 to limit the instruction set the dispatched kernels use.
+
+ Usage: router_kernel_bench [samples per segment] [iterations]
+ */
+
+#include "kernels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <vector>
+
+using namespace gr::router;
+
+static double now(){
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static volatile float sink; // Keeps the compiler from dropping the benchmarked calls
+
+/// Print the throughput of a kernel and of its generic version, in millions of samples per second
+static void report(const char *name, double fast, double generic, int samples, int iterations){
+    double total = (double)samples * iterations / 1e6;
+    printf("%-16s %10.1f %10.1f %8.2fx\n", name, total / fast, total / generic, generic / fast);
+}
+
+int main(int argc, char **argv){
+    
+    int samples = (argc > 1) ? atoi(argv[1]) : 768 * 16;
+    int iterations = (argc > 2) ? atoi(argv[2]) : 20000;
+    
+    std::vector<float> floats(samples), result(samples);
+    std::vector<char> bytes(samples * sizeof(float));
+    
+    for(int i = 0; i < samples; i++)
+        floats[i] = (float)((rand() % 20001) - 10000) / 10000.0f;
+    
+    printf("Kernel arch: %s; %d samples x %d iterations\n", kernel_arch(), samples, iterations);
+    printf("%-16s %10s %10s %9s\n", "kernel", "Msamp/s", "scalar", "speedup");
+    
+    double start, fast, generic;
+    
+    start = now();
+    for(int i = 0; i < iterations; i++) sink = max_magnitude(&floats[0], samples);
+    fast = now() - start;
+    start = now();
+    for(int i = 0; i < iterations; i++) sink = max_magnitude_generic(&floats[0], samples);
+    generic = now() - start;
+    report("max_magnitude", fast, generic, samples, iterations);
+    
+    start = now();
+    for(int i = 0; i < iterations; i++) float_to_int16(&floats[0], &bytes[0], 32767.0f, samples);
+    fast = now() - start;
+    start = now();
+    for(int i = 0; i < iterations; i++) float_to_int16_generic(&floats[0], &bytes[0], 32767.0f, samples);
+    generic = now() - start;
+    report("float_to_int16", fast, generic, samples, iterations);
+    
+    start = now();
+    for(int i = 0; i < iterations; i++) int16_to_float(&bytes[0], &result[0], 1.0f / 32767.0f, samples);
+    fast = now() - start;
+    start = now();
+    for(int i = 0; i < iterations; i++) int16_to_float_generic(&bytes[0], &result[0], 1.0f / 32767.0f, samples);
+    generic = now() - start;
+    report("int16_to_float", fast, generic, samples, iterations);
+    
+    start = now();
+    for(int i = 0; i < iterations; i++) float_to_int8(&floats[0], &bytes[0], 127.0f, samples);
+    fast = now() - start;
+    start = now();
+    for(int i = 0; i < iterations; i++) float_to_int8_generic(&floats[0], &bytes[0], 127.0f, samples);
+    generic = now() - start;
+    report("float_to_int8", fast, generic, samples, iterations);
+    
+    start = now();
+    for(int i = 0; i < iterations; i++) int8_to_float(&bytes[0], &result[0], 1.0f / 127.0f, samples);
+    fast = now() - start;
+    start = now();
+    for(int i = 0; i < iterations; i++) int8_to_float_generic(&bytes[0], &result[0], 1.0f / 127.0f, samples);
+    generic = now() - start;
+    report("int8_to_float", fast, generic, samples, iterations);
+    
+    start = now();
+    for(int i = 0; i < iterations; i++) byteswap32(&floats[0], &bytes[0], samples);
+    fast = now() - start;
+    start = now();
+    for(int i = 0; i < iterations; i++) byteswap32_generic(&floats[0], &bytes[0], samples);
+    generic = now() - start;
+    report("byteswap32", fast, generic, samples, iterations);
+    
+    start = now();
+    for(int i = 0; i < iterations; i++) byteswap16(&floats[0], &bytes[0], samples * 2);
+    fast = now() - start;
+    start = now();
+    for(int i = 0; i < iterations; i++) byteswap16_generic(&floats[0], &bytes[0], samples * 2);
+    generic = now() - start;
+    report("byteswap16", fast, generic, samples, iterations);
+    
+    start = now();
+    for(int i = 0; i < iterations; i++) sink = (float)crc32c(0, &floats[0], samples * sizeof(float));
+    fast = now() - start;
+    start = now();
+    for(int i = 0; i < iterations; i++) sink = (float)crc32c_generic(0, &floats[0], samples * sizeof(float));
+    generic = now() - start;
+    report("crc32c", fast, generic, samples, iterations);
+    
+    return 0;
+}
@@ -23,9 +23,11 @@
 #define INCLUDED_ROUTER_CHILD_H
 
 #include <router/api.h>
+#include <router/connection_options.h>
 #include <gnuradio/sync_block.h>
 #include <queue>
 #include <memory>
+#include <vector>
 #include <boost/lockfree/queue.hpp>
 #include <boost/thread.hpp>
 
@@ -49,8 +51,22 @@ namespace gr {
        * constructor is in a private implementation
        * class. router::child::make is the public interface for
        * creating new instances.
+       *
+       * \param options The socket options of the link to the parent, and the CPU of the thread that receives from it.
+       */
+      static sptr make(int n, int child_index, char* hostname, boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > &in_queue, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &out_queue, double throughput, const connection_options &options = connection_options());
+
+      /*!
+       * \brief Return a shared_ptr to a new router::child that feeds several local pipelines.
+       *
+       * Each in_queues[k] / out_queues[k] pair is the input and output queue of its own copy of the
+       * processing chain (queue_source -> processing -> queue_sink_byte). Every segment from the parent
+       * goes to the pipeline with the fewest segments outstanding, and the results of all pipelines go
+       * back over the one link. The weight reported to the parent is its outstanding segments over all pipelines.
+       *
+       * \param options The socket options of the link to the parent, and the CPU of the thread that receives from it.
        */
-      static sptr make(int n, int child_index, char* hostname, boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > &in_queue, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &out_queue, double throughput);
+      static sptr make(int n, int child_index, char* hostname, const std::vector< boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> >* > &in_queues, const std::vector< boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> >* > &out_queues, double throughput, const connection_options &options = connection_options());
     };
 
   } // namespace router
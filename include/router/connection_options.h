@@ -0,0 +1,72 @@
+/* -*- c++ -*- */
+/* 
+ * Copyright 2014 Tommy Tracy II.
+ * 
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef INCLUDED_ROUTER_CONNECTION_OPTIONS_H
+#define INCLUDED_ROUTER_CONNECTION_OPTIONS_H
+
+#include <vector>
+
+namespace gr {
+  namespace router {
+
+    /*!
+     * \brief Socket options applied to every link of a root or child router.
+     * \ingroup router
+     *
+     * The defaults leave every socket as the kernel creates it. A buffer size or
+     * busy poll time of 0 keeps the kernel default.
+     *
+     * receive_cpus pins the thread that receives from each link: entry 0 is the
+     * link to the parent, and entry i + 1 is the link to child i. Links without an
+     * entry, or with a negative entry, are not pinned.
+     *
+     * io_uring moves the I/O of the links onto one io_uring thread (Linux 5.6 or
+     * later). If the ring cannot be set up, the links fall back to the sockets.
+     *
+     * result_word_size is read by the root only: the size of the words in the
+     * data field of the results (1 for bytes, 2 for shorts, 4 for floats and
+     * complex floats). The root proposes it to the children, so the results
+     * travel little-endian like the rest of the wire, and children on
+     * big-endian hosts can join the tree.
+     */
+    struct connection_options {
+      bool no_delay;         // TCP_NODELAY; send every frame as soon as it is written
+      int send_buffer;       // SO_SNDBUF in bytes
+      int receive_buffer;    // SO_RCVBUF in bytes
+      int busy_poll;         // SO_BUSY_POLL in microseconds
+      bool quick_ack;        // TCP_QUICKACK; re-armed after every read, since the kernel clears it
+      bool reuse_address;    // SO_REUSEADDR on the listening socket, so a restarted root can bind at once
+      std::vector<int> receive_cpus; // CPU of the receive thread of each link
+      bool io_uring;         // Use the io_uring transport
+      int result_word_size;  // Bytes per word of the result data (1, 2 or 4)
+
+      connection_options()
+      : no_delay(false), send_buffer(0), receive_buffer(0), busy_poll(0),
+        quick_ack(false), reuse_address(false), io_uring(false),
+        result_word_size(1)
+      {
+      }
+    };
+
+  } // namespace router
+} // namespace gr
+
+#endif /* INCLUDED_ROUTER_CONNECTION_OPTIONS_H */
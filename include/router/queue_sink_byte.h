@@ -50,7 +50,7 @@ namespace gr {
        * class. router::queue_sink_byte::make is the public interface for
        * creating new instances.
        */
-      static sptr make(int item_size, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &shared_queue, bool preserve_index);
+      static sptr make(int item_size, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &shared_queue, bool preserve_index, int overlap = 0);
 
     };
 
@@ -0,0 +1,73 @@
+/* -*- c++ -*- */
+/* 
+ * Copyright 2014 Tommy Tracy II.
+ * 
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef INCLUDED_ROUTER_QUEUE_SINK_TYPED_H
+#define INCLUDED_ROUTER_QUEUE_SINK_TYPED_H
+
+#include <router/api.h>
+#include <gnuradio/sync_block.h>
+#include <gnuradio/gr_complex.h>
+#include <vector>
+#include <boost/lockfree/queue.hpp>
+
+namespace gr {
+  namespace router {
+
+    /*!
+     * \brief Segments a stream of samples of type T and pushes the segments into a queue.
+     * \ingroup router
+     *
+     * The samples are packed into the segments as raw bytes, so complex, short and
+     * 8-bit IQ streams can be routed without first being converted to floats, and
+     * float results can be pushed into a byte queue without first being converted to bytes.
+     * Segments can be pushed into a float queue (the root router's input queue) or
+     * into a byte queue (the child router's output queue). With an overlap, every
+     * segment starts with the last overlap samples of the previous one (zeros before
+     * the first), so filters that need history can be routed.
+     */
+    template <class T>
+    class ROUTER_API queue_sink_typed : virtual public gr::sync_block
+    {
+    public:
+       typedef boost::shared_ptr< queue_sink_typed<T> > sptr;
+
+       /*!
+        * \brief Return a shared_ptr to a new instance of router::queue_sink_typed
+        * that pushes float (type-1) segments.
+        */
+        static sptr make(boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > &shared_queue, bool preserve_index, int overlap = 0);
+
+       /*!
+        * \brief Return a shared_ptr to a new instance of router::queue_sink_typed
+        * that pushes byte (type-2) segments.
+        */
+        static sptr make(boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &shared_queue, bool preserve_index, int overlap = 0);
+   };
+
+    typedef queue_sink_typed<gr_complex> queue_sink_c;
+    typedef queue_sink_typed<float> queue_sink_f;
+    typedef queue_sink_typed<short> queue_sink_s;
+    typedef queue_sink_typed<signed char> queue_sink_b;
+
+  } // namespace router
+} // namespace gr
+
+#endif /* INCLUDED_ROUTER_QUEUE_SINK_TYPED_H */
@@ -51,7 +51,12 @@ namespace gr {
         * creating new instances.
         */
        //static sptr make(int item_size, boost::shared_ptr< boost::lockfree::queue< std::vector<float>* > > shared_queue, bool preserve_index, bool order);
-        static sptr make(int item_size, boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > &shared_queue, bool preserve_index, bool order);
+        static sptr make(int item_size, boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > &shared_queue, bool preserve_index, bool order, int overlap = 0, int reorder_depth = 0, double reorder_timeout = 0);
+
+       /*!
+        * \brief Segments given up on so far; a gap tag marks each run of them (see reorder_depth and reorder_timeout).
+        */
+        virtual uint64_t segments_skipped() = 0;
     };
 
   } // namespace router
@@ -0,0 +1,77 @@
+/* -*- c++ -*- */
+/* 
+ * Copyright 2014 Tommy Tracy II.
+ * 
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef INCLUDED_ROUTER_QUEUE_SOURCE_TYPED_H
+#define INCLUDED_ROUTER_QUEUE_SOURCE_TYPED_H
+
+#include <router/api.h>
+#include <gnuradio/sync_block.h>
+#include <gnuradio/gr_complex.h>
+#include <vector>
+#include <boost/lockfree/queue.hpp>
+
+namespace gr {
+  namespace router {
+
+    /*!
+     * \brief Pops segments off of a queue and streams out their data as samples of type T.
+     * \ingroup router
+     *
+     * This is the counterpart of router::queue_sink_typed. Segments can be popped from
+     * a float queue (the child router's input queue) or from a byte queue (the root
+     * router's output queue). With an overlap, the first overlap samples of every
+     * segment are dropped; they are the output of the history a queue sink added.
+     * With ordering, reorder_depth and reorder_timeout bound the wait for a segment
+     * that is missing; once either is reached, a gap tag takes its place.
+     */
+    template <class T>
+    class ROUTER_API queue_source_typed : virtual public gr::sync_block
+    {
+    public:
+       typedef boost::shared_ptr< queue_source_typed<T> > sptr;
+
+       /*!
+        * \brief Return a shared_ptr to a new instance of router::queue_source_typed
+        * that pops float (type-1) segments.
+        */
+        static sptr make(boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > &shared_queue, bool preserve_index, bool order, int overlap = 0, int reorder_depth = 0, double reorder_timeout = 0);
+
+       /*!
+        * \brief Return a shared_ptr to a new instance of router::queue_source_typed
+        * that pops byte (type-2) segments.
+        */
+        static sptr make(boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &shared_queue, bool preserve_index, bool order, int overlap = 0, int reorder_depth = 0, double reorder_timeout = 0);
+
+       /*!
+        * \brief Segments given up on so far; a gap tag marks each run of them (see reorder_depth and reorder_timeout).
+        */
+        virtual uint64_t segments_skipped() = 0;
+   };
+
+    typedef queue_source_typed<gr_complex> queue_source_c;
+    typedef queue_source_typed<float> queue_source_f;
+    typedef queue_source_typed<short> queue_source_s;
+    typedef queue_source_typed<signed char> queue_source_b;
+
+  } // namespace router
+} // namespace gr
+
+#endif /* INCLUDED_ROUTER_QUEUE_SOURCE_TYPED_H */
@@ -23,6 +23,9 @@
 #define INCLUDED_ROUTER_ROOT_H
 
 #include <router/api.h>
+#include <router/wire_codec.h>
+#include <router/connection_options.h>
+#include <router/scheduler_options.h>
 #include <gnuradio/sync_block.h>
 #include <queue>
 #include <memory>
@@ -48,8 +51,36 @@ namespace gr {
        * constructor is in a private implementation
        * class. router::root::make is the public interface for
        * creating new instances.
+       *
+       * \param sample_codec The wire_codec proposed to the children for the samples sent to them (CODEC_NONE, CODEC_SC16 or CODEC_SC8).
+       * \param result_codec The wire_codec proposed to the children for the results sent back (CODEC_NONE or CODEC_LZ).
+       * \param checksum Append a CRC32C trailer to every segment on the links, and drop the segments that arrive corrupted.
+       * \param send_workers The number of sender threads; each one encodes and queues the segments of its own share of the children.
+       * \param options The socket options of the links to the children, and the CPUs of the threads that receive from them.
+       * \param scheduling How the segments are spread over the children: sticky runs, a local lane, work stealing and deadlines.
+       */
+      static sptr make(int number_of_children, boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > &in_queue, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &out_queue, double throughput, int sample_codec = CODEC_NONE, int result_codec = CODEC_NONE, bool checksum = false, int send_workers = 1, const connection_options &options = connection_options(), const scheduler_options &scheduling = scheduler_options());
+
+      /*!
+       * \brief Add another stream to the tree; its segments share the children with the other streams.
+       *
+       * Each stream has its own input and output queue. Its results come back to its own output queue with the indexes
+       * they had in its input queue, and its kill message follows once all of them are out. While several streams have
+       * segments waiting, the segments are taken in weighted fair order, so each stream gets a share of the children in
+       * proportion to its weight. The children are sent the end of the stream once every stream has ended.
+       *
+       * \param in_queue The input queue of the stream.
+       * \param out_queue The output queue of the stream.
+       * \param weight The share of the stream, relative to the weights of the other streams (the stream given to make() has weight 1).
+       * \return The ID of the stream (the stream given to make() is 0); -1 if the children have already been sent the end of the stream.
        */
-      static sptr make(int number_of_children, boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > &in_queue, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &out_queue, double throughput);
+      virtual int add_stream(boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > &in_queue, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &out_queue, double weight = 1) = 0;
+
+      //! Segments shed so far because they could not meet their deadline
+      virtual uint64_t segments_shed() = 0;
+
+      //! Results that came back after their deadline so far
+      virtual uint64_t results_late() = 0;
     };
 
   } // namespace router
@@ -0,0 +1,87 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2014 Tommy Tracy II.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_ROUTER_SCHEDULER_OPTIONS_H
+#define INCLUDED_ROUTER_SCHEDULER_OPTIONS_H
+
+#include <vector>
+#include <cstddef>
+#include <boost/lockfree/queue.hpp>
+
+namespace gr {
+  namespace router {
+
+    /*!
+     * \brief How a root router spreads the segments over its children.
+     * \ingroup router
+     *
+     * The defaults balance every segment over the children alone, without
+     * stealing or deadlines.
+     *
+     * affinity_run is the number of consecutive segments sent to the same child
+     * before the least loaded child is picked again. 1 balances every segment;
+     * longer runs keep stateful child flow graphs (PLLs, AGCs, decoders) on one
+     * stretch of the stream. A queue sink overlap repeats history at the front of
+     * every segment, not only at the first of a run, so a stateful block sees
+     * those samples twice in the middle of a run. Runs are kept only by this
+     * scheduler: work stealing moves held-back segments of a run to another
+     * child, a child with several pipelines spreads a run over them, and deadline
+     * scheduling picks a lane for every segment.
+     *
+     * local_in and local_out are the queues of an optional local lane: a flow
+     * graph on the root itself, built like a child's (queue_source -> processing
+     * -> queue_sink_byte into local_out). Its results are merged into the output
+     * queue of the root. The local lane takes segments only once every child has
+     * at least local_threshold segments outstanding, and holds at most that many
+     * itself.
+     *
+     * steal_depth turns on work stealing: each child keeps at most this many
+     * segments per pipeline queued for its flow graph and holds the rest back, and
+     * a child that runs out of work takes half of the held back segments of the
+     * busiest child, through the root. Their results come back under their
+     * original index.
+     *
+     * sample_rate turns on deadlines for real-time streams: it is the floats of
+     * the input segments captured per second (twice the sample rate for complex
+     * samples). Segments then wait for a lane earliest deadline first, and a
+     * segment whose result could not come back within latency seconds of the
+     * capture of its last sample is shed; a gap segment takes its place in the
+     * output queue, and the queue source turns it into a "gap" stream tag.
+     */
+    struct scheduler_options {
+      int affinity_run;      // Consecutive segments per child
+      boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > *local_in;  // Input queue of the local lane; NULL for none
+      boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > *local_out;  // Output queue of the local lane
+      int local_threshold;   // Segments outstanding at every child before the local lane takes any
+      int steal_depth;       // Segments per pipeline a child queues for its flow graph; 0 turns stealing off
+      double sample_rate;    // Floats captured per second; 0 turns deadlines off
+      double latency;        // Seconds from the capture of a segment's last sample until its result is due
+
+      scheduler_options()
+      : affinity_run(1), local_in(NULL), local_out(NULL), local_threshold(0),
+        steal_depth(0), sample_rate(0), latency(0)
+      {
+      }
+    };
+
+  } // namespace router
+} // namespace gr
+
+#endif /* INCLUDED_ROUTER_SCHEDULER_OPTIONS_H */
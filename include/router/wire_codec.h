@@ -0,0 +1,50 @@
+/* -*- c++ -*- */
+/* 
+ * Copyright 2014 Tommy Tracy II.
+ * 
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef INCLUDED_ROUTER_WIRE_CODEC_H
+#define INCLUDED_ROUTER_WIRE_CODEC_H
+
+namespace gr {
+  namespace router {
+
+    /*!
+     * \brief Codecs that can be applied to the segments on a router link.
+     * \ingroup router
+     *
+     * The root router proposes a codec for the samples it sends and a codec for the
+     * results it receives; each child router accepts them when it connects.
+     *
+     * CODEC_SC16 and CODEC_SC8 quantize float samples to 16 or 8 bits with a scale
+     * factor per segment. They are lossy, and only make sense for segments that carry
+     * float samples (not for segments of packed complex/short/8-bit samples).
+     * CODEC_LZ is a fast lossless compressor for the byte results.
+     */
+    enum wire_codec {
+      CODEC_NONE = 0,
+      CODEC_SC16 = 1,
+      CODEC_SC8 = 2,
+      CODEC_LZ = 3
+    };
+
+  } // namespace router
+} // namespace gr
+
+#endif /* INCLUDED_ROUTER_WIRE_CODEC_H */
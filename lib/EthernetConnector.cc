@@ -19,18 +19,24 @@
  */
 
 #include "EthernetConnector.h"
+#include <netinet/tcp.h>
 
 /*!
  *	This is the public constuctor for the Ethernet Connector.
  *
  *  @param count The number of children that the router will connect to.
  *  @param port The port on which the router will communicate.
+ *  @param link_options The socket options applied to every link.
  */
 
-EthernetConnector::EthernetConnector(int count, int port){
+EthernetConnector::EthernetConnector(int count, int port, const gr::router::connection_options &link_options){
     
 	// Number of child nodes
 	numChildren = count;
+	options = link_options;
+	children = NULL;
+	local.socket_fd = -1;
+	parent.socket_fd = -1;
     
 	// If node has > 0 children, create array of children
 	if(V)
@@ -41,6 +47,8 @@ EthernetConnector::EthernetConnector(int count, int port){
         
 		// Create array of Children Nodes
 		children = new Node[numChildren];
+		for(int i = 0; i < numChildren; i++)
+			children[i].socket_fd = -1;
         
 		// Create a local node and set port, then set FD
 		local.port = port;
@@ -50,7 +58,7 @@ EthernetConnector::EthernetConnector(int count, int port){
 }
 
 /*!
- *	This is the destructor for the Ethernet Connector.
+ *	This is the destructor for the Ethernet Connector. It closes the sockets; the rest of the process carries on.
  */
 
 EthernetConnector::~EthernetConnector(){
@@ -59,7 +67,6 @@ EthernetConnector::~EthernetConnector(){
 		std::cout <<"\tEthernetConnector: Calling EthernetConnector Destructor" << std::endl;
 	stop();
 	delete[] children;
-	exit(0);
 }
 
 // Set local socket FD
@@ -73,6 +80,16 @@ bool EthernetConnector::set_local_fd(){
     	std::cout << "\tEthernetConnector: Serious Error: Could not create a local socket!" << std::endl;
         return false;
     }
+    
+    // Allow binding while connections of a previous run are still in TIME_WAIT
+    if(options.reuse_address){
+    	int on = 1;
+    	if(setsockopt(local.socket_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0)
+    		perror("\tEthernetConnector: Warning: SO_REUSEADDR");
+    }
+    
+    // Accepted sockets inherit the buffer sizes; they must be set before the window is negotiated
+    set_buffer_options(local.socket_fd);
 	
 	local.length = sizeof(local.address);
     bzero((char *) &(local.address), (local.length));
@@ -131,6 +148,8 @@ bool EthernetConnector::connect_to_child(int index, int port){
 		return false;
 	}
 	
+	set_link_options(children[index].socket_fd);
+    
 	// Child is now connected
 	if(V)printf("Connected to Child!\n");
 	return true;
@@ -138,6 +157,22 @@ bool EthernetConnector::connect_to_child(int index, int port){
 
 // Write to the child at index Children[index] the msg of size size
 
+/*!
+ *	Gather write that never blocks, even on a blocking socket (the io_uring transport keeps its sockets blocking),
+ *  and never raises SIGPIPE; a closed peer comes back as EPIPE, like the sends of the io_uring thread.
+ *  Like every write of the connector, it fails with EAGAIN when the socket buffer is full; the caller waits for room.
+ */
+
+static ssize_t writev_nowait(int fd, const struct iovec *iov, int count){
+    
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = (struct iovec *)iov;
+	msg.msg_iovlen = count;
+    
+	return sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
 /*!
  *	This is the public constuctor for the Ethernet Connector.
  *
@@ -155,7 +190,29 @@ int EthernetConnector::write_child(int index, char * inbuf, unsigned long size){
 	}
     
 	// Write to child file descriptor
-	ssize_t r = write((children[index]).socket_fd, inbuf, size);
+	ssize_t r = ::send((children[index]).socket_fd, inbuf, size, MSG_DONTWAIT | MSG_NOSIGNAL);
+    
+	return r;
+}
+
+/*!
+ *	Write several buffers to the child at index Children[index] with one system call.
+ *
+ *  @param index The index of the child to write to.
+ *  @param iov The buffers to write, in order.
+ *  @param count The number of buffers.
+ *  @return r The number of bytes written to the child.
+ */
+
+int EthernetConnector::writev_child(int index, const struct iovec *iov, int count){
+	
+    // If the index is not valid, return ERROR
+    if(index > (numChildren - 1)){
+		if(V)printf("\tERROR: EthernetConnector: index > number of children - 1\n");
+		return false;
+	}
+    
+	ssize_t r = writev_nowait((children[index]).socket_fd, iov, count);
     
 	return r;
 }
@@ -173,6 +230,9 @@ int EthernetConnector::read_child(int index, char * outbuf, int size){
     // Read from the child file descriptor
 	ssize_t r = read((children[index]).socket_fd, outbuf, size);
     
+	if(options.quick_ack)
+		rearm_quick_ack(children[index].socket_fd);
+    
 	return r;
 }
 
@@ -199,9 +259,13 @@ bool EthernetConnector::connect_to_parent(char* hostname, int port){
     // Attempt to connect to parent
     if(connect(parent.socket_fd, (sockaddr *)&parent.address, sizeof(parent.address))){
         printf("\tEthernetConnector: Serious Error: Failed connecting to Parent\n");
+        close(parent.socket_fd); // A failed socket cannot be connected again; the next attempt makes a new one
+        parent.socket_fd = -1;
         return false;
     }
     
+    set_link_options(parent.socket_fd);
+    
     return true;
 }
 
@@ -220,6 +284,9 @@ bool EthernetConnector::set_parent_fd(){
 		return false;
 	}
     
+	// Buffer sizes must be set before connecting, so the window scale is negotiated for them
+	set_buffer_options(parent.socket_fd);
+    
 	parent.length = sizeof(parent.address);
 	bzero((char *) &parent.address, parent.length);
 	parent.address.sin_family = AF_INET;
@@ -243,7 +310,23 @@ int EthernetConnector::write_parent(char * msg, int size){
     
 	// Critical section, we dont want threads writing to the same FD at the same time
 	write_parent_mutex.lock();
-	ssize_t r = write(parent.socket_fd,msg,size);
+	ssize_t r = ::send(parent.socket_fd, msg, size, MSG_DONTWAIT | MSG_NOSIGNAL);
+	write_parent_mutex.unlock();
+	return r;
+}
+
+/*!
+ *	Write several buffers to the parent with one system call.
+ *
+ *  @param iov The buffers to write, in order.
+ *  @param count The number of buffers.
+ *  @return r The number of bytes written to the parent.
+ */
+
+int EthernetConnector::writev_parent(const struct iovec *iov, int count){
+    
+	write_parent_mutex.lock();
+	ssize_t r = writev_nowait(parent.socket_fd, iov, count);
 	write_parent_mutex.unlock();
 	return r;
 }
@@ -261,6 +344,8 @@ int EthernetConnector::read_parent(char * outbuf, int size){
     // Critical section; we don't want to have multiple threads read from the same FD at the same time
 	read_parent_mutex.lock();
 	int r = read((parent.socket_fd), outbuf, size);
+	if(options.quick_ack)
+		rearm_quick_ack(parent.socket_fd);
 	read_parent_mutex.unlock();
 	return r;
 }
@@ -272,12 +357,67 @@ int EthernetConnector::read_parent(char * outbuf, int size){
 void EthernetConnector::stop()
 {
 	// Close all open file descriptors (local, parent, children)
-	if(numChildren > 0){
+	if(local.socket_fd >= 0)
 		close(local.socket_fd);
+	if(parent.socket_fd >= 0)
 		close(parent.socket_fd);
-	}
+	local.socket_fd = parent.socket_fd = -1;
     
 	for(int i = 0; i < numChildren; i++){
-		close((children[i].socket_fd));
+		if(children[i].socket_fd >= 0)
+			close((children[i].socket_fd));
+		children[i].socket_fd = -1;
 	}
+}
+
+/*!
+ *	Set the socket buffer sizes of the connection options (0 keeps the kernel default).
+ *
+ *  @param fd The socket to set the buffer sizes of.
+ */
+
+void EthernetConnector::set_buffer_options(int fd){
+    
+	if(options.send_buffer > 0 && setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &options.send_buffer, sizeof(options.send_buffer)) < 0)
+		perror("\tEthernetConnector: Warning: SO_SNDBUF");
+    
+	if(options.receive_buffer > 0 && setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &options.receive_buffer, sizeof(options.receive_buffer)) < 0)
+		perror("\tEthernetConnector: Warning: SO_RCVBUF");
+}
+
+/*!
+ *	Set the connection options of a connected link. An option the kernel refuses only prints a warning.
+ *
+ *  @param fd The socket of the link.
+ */
+
+void EthernetConnector::set_link_options(int fd){
+    
+	if(options.no_delay){
+		int on = 1;
+		if(setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)) < 0)
+			perror("\tEthernetConnector: Warning: TCP_NODELAY");
+	}
+    
+#ifdef SO_BUSY_POLL
+	if(options.busy_poll > 0 && setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &options.busy_poll, sizeof(options.busy_poll)) < 0)
+		perror("\tEthernetConnector: Warning: SO_BUSY_POLL");
+#endif
+    
+	if(options.quick_ack)
+		rearm_quick_ack(fd);
+}
+
+/*!
+ *	Ask for the next ACK to be sent at once. The kernel falls back to delayed ACKs on its own, so this is repeated after every read.
+ *
+ *  @param fd The socket of the link.
+ */
+
+void EthernetConnector::rearm_quick_ack(int fd){
+    
+#ifdef TCP_QUICKACK
+	int on = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &on, sizeof(on));
+#endif
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 
 // Ethernet Connector
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/types.h>
@@ -14,6 +15,7 @@
 #include <netdb.h>
 #include <stdio.h>
 #include <string.h>
+#include <router/connection_options.h>
 
 #include <boost/thread.hpp>// used for lock
 
@@ -35,22 +37,31 @@ class EthernetConnector{
 public:
     
 	// Default Constructor / Destructor
-	EthernetConnector(int number_of_children, int port);
+	EthernetConnector(int number_of_children, int port, const gr::router::connection_options &options = gr::router::connection_options());
 	~EthernetConnector();
 	
 	// Parent functions
 	bool connect_to_parent(char* hostname, int port);
 	int write_parent(char * msg, int size); // Return number of bytes written
+	int writev_parent(const struct iovec *iov, int count); // Gather write; return number of bytes written
 	int read_parent(char * outbuf, int size); // Return number of bytes read
     
 	// Child functions
 	bool connect_to_child(int index, int port);
 	int write_child(int index, char * inbuf, unsigned long size); // Return number of bytes written
+	int writev_child(int index, const struct iovec *iov, int count); // Gather write; return number of bytes written
 	int read_child(int index, char * outbuf, int size); // Return number of bytes read
     
-	// Close all file descriptors
+	// Socket file descriptors, for polling
+	int child_fd(int index){ return children[index].socket_fd; }
+	int parent_fd(){ return parent.socket_fd; }
+    
+	// Close all file descriptors (safe to call more than once)
 	void stop();
     
+	// Socket options of the links
+	const gr::router::connection_options& get_options(){ return options; }
+    
 private:
     
 	// Private Variables
@@ -60,6 +71,9 @@ private:
 	
 	int numChildren;
     
+	// Socket options applied to every link
+	gr::router::connection_options options;
+    
 	// Locks for File Descriptor access
 	boost::mutex read_parent_mutex;
 	boost::mutex write_parent_mutex;
@@ -69,6 +83,9 @@ private:
 	// Private Functions
 	bool set_local_fd();
 	bool set_parent_fd();
+	void set_buffer_options(int fd);
+	void set_link_options(int fd);
+	void rearm_quick_ack(int fd);
 };
 
 #endif
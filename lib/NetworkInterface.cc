@@ -19,6 +19,9 @@
  */
 
 #include "NetworkInterface.h"
+#include "wire_format.h"
+#include "affinity.h"
+#include "uring.h"
 
 #include <cstdio>
 #include <errno.h>
@@ -26,9 +29,32 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <stdexcept>
+#include <algorithm>
 #include <stdio.h>
 #include <iostream>
 #include <assert.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <boost/bind.hpp>
+#include <sys/uio.h>
+
+/*
+ Format of a frame
+ |
+ byte * 4 < sync :: [0,1,2,3] > -- 'G' 'R' 'F' 'M'
+ byte * 4 (int) < length :: [4,5,6,7] > -- little-endian number of bytes in the body (including the checksum)
+ byte < body :: [8, ...] > -- one router message
+ byte * 4 < checksum > -- only if agreed; little-endian CRC32C of the frame header and the body before it
+ |
+ If the sync word or the length do not make sense, the receiver throws bytes away one at a time
+ until they do, so a corrupt frame costs that frame only. A frame that fails its checksum may
+ have a corrupt length, so its bytes past the sync word are scanned again the same way; a length
+ that grew into the frames behind it does not take them down with it.
+ */
+
+static const char FRAME_SYNC[4] = {'G', 'R', 'F', 'M'};
+static const int FRAME_HEADER_SIZE = 8;
+static const int FRAME_MAX_SIZE = (1 << 26); // Longer frames are taken as a lost frame boundary
 
 /*!
  *	Public Constructor for the Network Interface.
@@ -37,24 +63,64 @@
  *  @param children_count The number of children that this node has.
  *  @param port_arg The port on which this node will communicate on.
  *  @param root_arg True if this node is the root; else, False.
+ *  @param options The socket options applied to every link.
  */
 
-NetworkInterface::NetworkInterface(int itemsize, int children_count, int port_arg, bool root_arg){
+NetworkInterface::NetworkInterface(int itemsize, int children_count, int port_arg, bool root_arg, const gr::router::connection_options &options){
     
 	d_itemsize = itemsize; // The size of each element in the packet; going to be using bytes = 1
 	children = children_count;  // Number of children
 	port = port_arg; // Port to connect with
 	root = root_arg;  // Is this node the Root node?
-	d_residue  = new unsigned char[itemsize];
-	d_residue_len = 0;
+	d_counters = new link_counters[children_count + 1];
+	memset(d_counters, 0, (children_count + 1) * sizeof(link_counters));
+    
+	// One receive ring per link, so the receiver threads share nothing
+	d_rings = new receive_ring[children_count + 1];
+	for(int i = 0; i < children_count + 1; i++){
+		d_rings[i].data = new char[RING_SIZE];
+		d_rings[i].head = 0;
+		d_rings[i].count = 0;
+		d_rings[i].replay_at = 0;
+		d_rings[i].reading = false;
+		d_rings[i].closed = false;
+	}
+    
+	d_outbound = new outbound_queue[children_count];
+	for(int i = 0; i < children_count; i++){
+		d_outbound[i].bytes = 0;
+		d_outbound[i].sending = false;
+	}
+    
+	d_writer_done = false;
+	d_wake_pipe[0] = d_wake_pipe[1] = -1;
+	d_uring = NULL;
+	d_fixed_buffers = false;
+	d_stopped = false;
+	d_stop_fd = eventfd(0, EFD_NONBLOCK);
     
 	// Create Ethernet Connector
-	connector = new EthernetConnector(children, port);
+	connector = new EthernetConnector(children, port, options);
 }
 
 /// Destructor
 NetworkInterface::~NetworkInterface(){
-	delete [] d_residue;
+    
+	stop();
+    
+	if(d_writer){
+		d_writer->join();
+		close(d_wake_pipe[0]);
+		close(d_wake_pipe[1]);
+	}
+	close(d_stop_fd);
+	delete d_uring; // Nothing is in flight any more; the io thread cancelled it
+	delete [] d_outbound;
+    
+	for(int i = 0; i < children + 1; i++)
+		delete [] d_rings[i].data;
+	delete [] d_rings;
+	delete [] d_counters;
 	delete connector;
 }
 
@@ -80,6 +146,8 @@ bool NetworkInterface::connect(char* parent_hostname){
 				sleep(1);
 			}
 		}
+        
+		start_io();
 		return true;
 	}
     
@@ -105,106 +173,231 @@ bool NetworkInterface::connect(char* parent_hostname){
 				sleep(1);
 			}
 		}
+        
+		start_io();
 		return true;
 	}
 }
 
-/// Code copied from file_descriptor_source_impl from GNURADIO code
-/// Used to read items from packet and rebuild stream
+/*!
+ *	Get the connected links ready for I/O: either the io_uring thread takes them over, or they are made non-blocking,
+ *  so that every wait on a link goes through wait_link() and can be cut short by stop().
+ */
 
-int NetworkInterface::read_items(int index, char *buf, int nitems){
-	
-	int r;
-	assert(nitems > 0);
-	assert(d_residue_len < d_itemsize);
+void NetworkInterface::start_io(){
     
-	int nbytes_read = 0;
+	// io_uring wants blocking sockets; it never blocks a thread on them. The writes that bypass the ring (to the parent,
+	// and before the ring takes over) do not block either: the connector writes with MSG_DONTWAIT (and MSG_NOSIGNAL, so a closed peer is EPIPE, not SIGPIPE), and waits in wait_link()
+	if(connector->get_options().io_uring && start_uring())
+		return;
     
-	if(d_residue_len > 0){
-		memcpy(buf, d_residue, d_residue_len);
-		nbytes_read = d_residue_len;
-		d_residue_len = 0;
+	for(int link = root ? 1 : 0; link < children + 1; link++){
+		int fd = link_fd(link);
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
 	}
+}
+
+/*!
+ *	Wake every thread that waits on a link, and make every later wait fail. Receivers get -1 (link closed), senders get
+ *  false, and the writer / io thread exits. The sockets themselves are closed when the interface is deleted.
+ */
+
+void NetworkInterface::stop(){
     
-    // Index -1 is parent index
-	if(index == -1){
-		r = connector->read_parent(buf + nbytes_read, nitems * d_itemsize - nbytes_read);
-	}
-	else{
-		r = connector->read_child(index, buf + nbytes_read, nitems * d_itemsize - nbytes_read);
+	if(d_stopped.exchange(true))
+		return;
+    
+	uint64_t one = 1;
+	if(write(d_stop_fd, &one, sizeof(one)) < 0)
+		perror("NetworkInterface::stop");
+    
+	// The io thread closes the rings on its way out, which wakes the receivers waiting on them
+	d_writer_done = true;
+	wake_writer();
+}
+
+/*!
+ *	Wait until the link is ready for the events, or stop() is called.
+ *
+ *  @param child_index Index of the node; -1 for parent; >= 0 for child
+ *  @param events POLLIN or POLLOUT
+ *  @return bool True if the link is ready (or failed; the next call on it tells); False if the interface is stopping.
+ */
+
+bool NetworkInterface::wait_link(int child_index, short events){
+    
+	struct pollfd p[2];
+	p[0].fd = (child_index == -1) ? connector->parent_fd() : connector->child_fd(child_index);
+	p[0].events = events;
+	p[1].fd = d_stop_fd;
+	p[1].events = POLLIN;
+    
+	while(!d_stopped){
+		p[0].revents = p[1].revents = 0;
+        
+		if(poll(p, 2, -1) < 0 && errno != EINTR){
+			perror("NetworkInterface::wait_link");
+			return false;
+		}
+		if(p[1].revents)
+			return false;
+		if(p[0].revents)
+			return true;
 	}
+	return false;
+}
+
+/*!
+ *	Place the calling thread as the receiver of a link: as GR_ROUTER_AFFINITY asks (see affinity.h), unless the
+ *  connection options give a CPU for the link, which wins.
+ *
+ *  @param child_index The index of the child the thread receives from; -1 for the parent.
+ */
+
+void NetworkInterface::pin_receiver(int child_index){
+    
+	gr::router::place_thread(gr::router::ROLE_RECEIVE, (child_index < 0) ? 0 : child_index);
+    
+	const std::vector<int> &cpus = connector->get_options().receive_cpus;
+	size_t link = child_index + 1;
+    
+	if(link < cpus.size() && cpus[link] >= 0)
+		gr::router::pin_thread_to_cpu(cpus[link]);
+}
+
+/*!
+ *	Read whatever the socket has (up to size bytes) with one system call.
+ *
+ *  @return r The number of bytes read; 0 if the link was closed; -1 on error.
+ */
+
+int NetworkInterface::read_socket(int child_index, char *buf, int size){
     
-	if(r <= 0){
-		handle_residue(buf, nbytes_read);
+	while(1){
+		int r;
+        
+		// Index -1 is parent index
+		if(child_index == -1)
+			r = connector->read_parent(buf, size);
+		else
+			r = connector->read_child(child_index, buf, size);
+        
+		if(r == -1 && errno == EINTR)
+			continue;
+        
+		// Non-blocking sockets: wait until there is something to read, or we are stopped
+		if(r == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)){
+			if(!wait_link(child_index, POLLIN))
+				return 0; // Stopped; same as a closed link
+			continue;
+		}
+		if(r == -1)
+			perror("\t\tNetworkInterface::read_socket");
 		return r;
 	}
+}
+
+/*!
+ *	Refill the receive ring of a link: one large read into the free space after the buffered bytes.
+ *
+ *  @return bool True if more bytes were buffered; False if the link was closed.
+ */
+
+bool NetworkInterface::fill(int child_index){
+    
+	receive_ring &ring = d_rings[child_index + 1];
+    
+	// With io_uring, the io thread reads into the ring; wait for it
+	if(d_uring){
+		while(ring.count == 0 && !ring.closed){
+			if(!ring.reading)
+				wake_writer(); // The ring was full when the io thread last looked
+			ring.ready.wait(ring.lock);
+		}
+		return ring.count > 0;
+	}
+    
+	if(ring.count == RING_SIZE)
+		return true; // Nothing to do; the ring is full
+    
+	if(ring.count == 0)
+		ring.head = 0; // Empty; start over at the front so the read can be as large as possible
     
-	r = handle_residue(buf, r+ nbytes_read);
+	size_t tail = (ring.head + ring.count) % RING_SIZE;
+	size_t space = (tail >= ring.head) ? (RING_SIZE - tail) : (ring.head - tail);
     
-	if(r == 0)
-		return read_items(index, buf, nitems);
+	int r = read_socket(child_index, &ring.data[tail], space);
+	if(r <= 0)
+		return false;
     
-	return r;
+	ring.count += r;
+	return true;
 }
 
-/// Code copied from file_descriptor_source_impl from GNURADIO code
-int NetworkInterface::handle_residue(char *buf, int nbytes_read){
-	assert(nbytes_read >= 0);
+/*!
+ *	Take up to size buffered bytes out of a link: first the bytes handed back by receive_frame(), then the receive ring.
+ *
+ *  @return The number of bytes copied into buf.
+ */
+
+int NetworkInterface::consume(int child_index, char *buf, int size){
+    
+	receive_ring &ring = d_rings[child_index + 1];
+    
+	int replayed = 0;
+	if(ring.replay_at < ring.replay.size()){
+		replayed = (int)std::min((size_t)size, ring.replay.size() - ring.replay_at);
+		memcpy(buf, &ring.replay[ring.replay_at], replayed);
+		ring.replay_at += replayed;
+        
+		if(ring.replay_at == ring.replay.size()){
+			ring.replay.clear();
+			ring.replay_at = 0;
+		}
+		buf += replayed;
+		size -= replayed;
+	}
     
-	int nitems_read = nbytes_read / d_itemsize;
-	d_residue_len = nbytes_read % d_itemsize;
-	if(d_residue_len > 0)
-		memcpy(d_residue, buf + nbytes_read - d_residue_len, d_residue_len);
+	size_t n = ((size_t)size < ring.count) ? size : ring.count;
     
-	return nitems_read;
+	// The buffered bytes may wrap around the end of the ring
+	size_t first = RING_SIZE - ring.head;
+	if(first > n)
+		first = n;
+    
+	memcpy(buf, &ring.data[ring.head], first);
+	memcpy(buf + first, &ring.data[0], n - first);
+    
+	ring.head = (ring.head + n) % RING_SIZE;
+	ring.count -= n;
+    
+	// The io thread stops reading while the ring is full; tell it there is room again
+	if(d_uring && n > 0 && !ring.reading && !ring.closed)
+		wake_writer();
+	return replayed + n;
 }
 
 /*!
- *	Receive function: Receive data from node with index child_index of size packet_size
- *  Code copied from file_descriptor_source_impl.cc
+ *	Receive function: Receive up to noutput_items bytes from node with index child_index.
+ *  Bytes already in the receive ring are returned first; otherwise the ring is refilled once.
  *
  *  @param child_index Index of the node to receive from; -1 for parent; >= 0 for child
  *  @param outbuf Pointer to byte array to write to.
- *  @param noutput_items The size in bytes of the data to be received.
- *  @return nread The number of bytes received from the node.
+ *  @param noutput_items The maximum number of bytes to be received.
+ *  @return nread The number of bytes received from the node; -1 if the link was closed.
  */
 
 int NetworkInterface::receive(int child_index, char * outbuf, int noutput_items){
 	assert(noutput_items > 0);
     
-	char *o = outbuf;
-	int nread = 0;
+	boost::mutex::scoped_lock lock(d_rings[child_index + 1].lock);
     
 	if(V) std::cout << "\t\t\t\tNetworkInterface Receiving from child " << child_index << std::endl;
-	if(V)std::cout << std::flush;
     
-	while(1){
-		int r = read_items(child_index, o, noutput_items - nread);
-		if(r == -1){
-			if(errno == EINTR)
-				continue;
-			else{
-				perror("\t\tNetworkInterface::receive");
-				return -1;
-			}
-		}
-		else if(r == 0){
-			break;
-		}
-		else{
-			o += r * d_itemsize;
-			nread += r;
-			break;
-		}
-	}
-    
-	if(nread == 0) // eof!
-		return -1;
+	if(d_rings[child_index + 1].count == 0 && d_rings[child_index + 1].replay.empty() && !fill(child_index))
+		return -1; // eof!
     
-	if(V) std::cout << "\t\t\t\tNetworkInterface done receiving from child " << child_index << std::endl;
-	if(V) std::cout << std::flush;
-    
-	return nread;
+	return consume(child_index, outbuf, noutput_items);
 }
 
 
@@ -239,6 +432,10 @@ int NetworkInterface::send(int child_index, char* msg, int packet_size){
 		if(r == -1){
 			if(errno == EINTR)
 				continue;
+			else if(errno == EAGAIN || errno == EWOULDBLOCK){
+				if(!wait_link(child_index, POLLOUT))
+					return -1; // Stopped
+			}
 			else{
 				perror("NetworkInterface::send");
 				return -1;
@@ -252,3 +449,686 @@ int NetworkInterface::send(int child_index, char* msg, int packet_size){
     
  	return packet_size;
 }
+
+/*!
+ *	Send one framed message: the frame header, the body and (with checksum) the CRC32C trailer go out in one gather write.
+ *
+ *  @param child_index Index of the node to send to; -1 for parent; >= 0 for child
+ *  @param body Pointer to the message.
+ *  @param size The size in bytes of the message.
+ *  @param checksum True to append a CRC32C trailer.
+ *  @return bool True if the whole frame was sent; else, False.
+ */
+
+bool NetworkInterface::send_frame(int child_index, const char *body, int size, bool checksum){
+    
+	char header[FRAME_HEADER_SIZE];
+	write_header(header, size, checksum);
+    
+	char trailer[4];
+	if(checksum)
+		gr::router::put_int32(trailer, (int32_t)gr::router::crc32c(gr::router::crc32c(0, header, FRAME_HEADER_SIZE), body, size));
+    
+	struct iovec iov[3];
+	iov[0].iov_base = header;
+	iov[0].iov_len = FRAME_HEADER_SIZE;
+	iov[1].iov_base = (void *)body;
+	iov[1].iov_len = size;
+	iov[2].iov_base = trailer;
+	iov[2].iov_len = checksum ? 4 : 0;
+    
+	struct iovec *next = iov;
+	int count = 3;
+    
+	while(count > 0){
+		ssize_t r;
+        
+		if(child_index == -1)
+			r = connector->writev_parent(next, count);
+		else
+			r = connector->writev_child(child_index, next, count);
+        
+		if(r == -1){
+			if(errno == EINTR)
+				continue;
+			if(errno == EAGAIN || errno == EWOULDBLOCK){
+				if(!wait_link(child_index, POLLOUT))
+					return false; // Stopped
+				continue;
+			}
+			perror("NetworkInterface::send_frame");
+			return false;
+		}
+        
+		// Skip over whatever was written; a partial write can end in the middle of a buffer
+		while(count > 0 && (size_t)r >= next->iov_len){
+			r -= next->iov_len;
+			next++;
+			count--;
+		}
+		if(count > 0){
+			next->iov_base = (char *)next->iov_base + r;
+			next->iov_len -= r;
+		}
+	}
+    
+	return true;
+}
+
+/// Write the frame header for a body of size bytes
+void NetworkInterface::write_header(char *header, int size, bool checksum){
+	memcpy(header, FRAME_SYNC, 4);
+	gr::router::put_int32(&header[4], size + (checksum ? 4 : 0));
+}
+
+/*!
+ *	Queue one framed message for a child. This never blocks; the writer thread sends the frame when the child's socket has room.
+ *  Frames queued for the same child go out in order.
+ *
+ *  @param child_index Index of the child to send to.
+ *  @param body Pointer to the message.
+ *  @param size The size in bytes of the message.
+ *  @param checksum True to append a CRC32C trailer.
+ *  @param owner Owner of the memory at body; released once the frame has been written.
+ */
+
+void NetworkInterface::queue_frame(int child_index, const char *body, int size, bool checksum, boost::shared_ptr<void> owner){
+    
+	outbound_frame frame;
+	write_header(frame.header, size, checksum);
+	frame.body = body;
+	frame.size = size;
+	frame.trailer_size = checksum ? 4 : 0;
+	frame.written = 0;
+	frame.owner = owner;
+    
+	if(checksum)
+		gr::router::put_int32(frame.trailer, (int32_t)gr::router::crc32c(gr::router::crc32c(0, frame.header, FRAME_HEADER_SIZE), body, size));
+    
+	outbound_queue &queue = d_outbound[child_index];
+	{
+		boost::mutex::scoped_lock lock(queue.lock);
+		queue.frames.push_back(frame);
+		queue.bytes += FRAME_HEADER_SIZE + size + frame.trailer_size;
+	}
+    
+	wake_writer();
+}
+
+/*!
+ *	Returns the number of bytes queued for the child at child_index that have not been written yet.
+ */
+
+size_t NetworkInterface::queued_bytes(int child_index){
+	boost::mutex::scoped_lock lock(d_outbound[child_index].lock);
+	return d_outbound[child_index].bytes;
+}
+
+/*!
+ *	Start the writer thread. From now on, frames to the children must be queued with queue_frame().
+ *  With io_uring, the io thread started by connect() is the writer.
+ */
+
+void NetworkInterface::start_writer(){
+    
+	// The io_uring thread already sends whatever is queued
+	if(d_uring)
+		return;
+    
+	if(pipe(d_wake_pipe) != 0){
+		perror("NetworkInterface::start_writer");
+		return;
+	}
+	fcntl(d_wake_pipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(d_wake_pipe[1], F_SETFL, O_NONBLOCK);
+    
+	d_writer = boost::shared_ptr< boost::thread >(new boost::thread(boost::bind(&NetworkInterface::write_loop, this)));
+}
+
+/// Wake the writer thread up (a full pipe already means it will wake up)
+void NetworkInterface::wake_writer(){
+	char byte = 0;
+	if(d_wake_pipe[1] >= 0 && write(d_wake_pipe[1], &byte, 1) < 0 && errno != EAGAIN)
+		perror("NetworkInterface::wake_writer");
+}
+
+/*
+ io_uring transport
+
+ One io thread owns the ring. It keeps, for every link, one read in flight into the free space of the
+ link's receive ring (registered with the kernel, so the reads are IORING_OP_READ_FIXED), and for every
+ child with queued frames, one gather send of up to MAX_GATHER_FRAMES frames. Bytes land directly in the
+ receive rings the frame parser reads from, and the receiver threads only wait on a condition variable.
+ TCP needs the bytes of a link in order, so there is never more than one send per child in flight.
+ */
+
+enum uring_request { URING_READ = 1, URING_SEND = 2, URING_WAKE = 3 };
+
+static uint64_t uring_tag(int kind, int link){ return ((uint64_t)kind << 32) | (uint32_t)link; }
+
+/*!
+ *	Set up the ring and start the io thread. If the kernel has no io_uring, the links stay on the sockets.
+ *
+ *  @return bool True if the io_uring transport is running.
+ */
+
+bool NetworkInterface::start_uring(){
+    
+	d_uring = new gr::router::uring();
+    
+	if(!d_uring->setup(2 * (children + 1) + 8)){
+		perror("\tNetworkInterface: Warning: io_uring is not available; using the sockets");
+		delete d_uring;
+		d_uring = NULL;
+		return false;
+	}
+    
+	// Registered rings save the kernel from mapping the pages on every read; they count against RLIMIT_MEMLOCK
+	std::vector<struct iovec> buffers(children + 1);
+	for(int i = 0; i < children + 1; i++){
+		buffers[i].iov_base = d_rings[i].data;
+		buffers[i].iov_len = RING_SIZE;
+	}
+	d_fixed_buffers = d_uring->register_buffers(&buffers[0], buffers.size());
+    
+	if(pipe(d_wake_pipe) != 0){
+		perror("NetworkInterface::start_uring");
+		delete d_uring;
+		d_uring = NULL;
+		return false;
+	}
+	fcntl(d_wake_pipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(d_wake_pipe[1], F_SETFL, O_NONBLOCK);
+    
+	d_writer = boost::shared_ptr< boost::thread >(new boost::thread(boost::bind(&NetworkInterface::io_loop, this)));
+	return true;
+}
+
+/// Socket of a link; link 0 is the parent, link i + 1 is child i
+int NetworkInterface::link_fd(int link){
+	return (link == 0) ? connector->parent_fd() : connector->child_fd(link - 1);
+}
+
+/*!
+ *	The io thread: keep the reads and sends in flight, and hand their results to the rings and queues.
+ */
+
+void NetworkInterface::io_loop(){
+    
+	gr::router::place_thread(gr::router::ROLE_WRITER, 0);
+    
+	bool wake_armed = false;
+	int first_link = root ? 1 : 0; // The root has no parent
+    
+	while(!d_writer_done){
+        
+		// Wake up when frames are queued, a receiver made room, or we are shutting down
+		if(!wake_armed){
+			struct io_uring_sqe *sqe = d_uring->get_sqe();
+			if(sqe != NULL){
+				sqe->opcode = IORING_OP_POLL_ADD;
+				sqe->fd = d_wake_pipe[0];
+				sqe->poll32_events = POLLIN;
+				sqe->user_data = uring_tag(URING_WAKE, 0);
+				wake_armed = true;
+			}
+		}
+        
+		for(int link = first_link; link < children + 1; link++)
+			submit_read(link);
+        
+		for(int i = 0; i < children; i++)
+			submit_send(i);
+        
+		int r = d_uring->submit_and_wait(1);
+		if(r < 0 && r != -EINTR && r != -EAGAIN && r != -EBUSY){
+			errno = -r;
+			perror("NetworkInterface::io_loop");
+			break;
+		}
+        
+		struct io_uring_cqe *cqe;
+		while((cqe = d_uring->next_cqe()) != NULL){
+            
+			int kind = (int)(cqe->user_data >> 32);
+			int link = (int)(uint32_t)cqe->user_data;
+			int result = cqe->res;
+			d_uring->cqe_seen();
+            
+			switch(kind){
+				case URING_READ:
+					complete_read(link, result);
+					break;
+				case URING_SEND:
+					complete_send(link, result);
+					break;
+				case URING_WAKE:
+				{
+					char drain[64];
+					while(read(d_wake_pipe[0], drain, sizeof(drain)) > 0)
+						;
+					wake_armed = false;
+					break;
+				}
+			}
+		}
+	}
+    
+	cancel_uring(wake_armed);
+}
+
+/*!
+ *	Cancel whatever the io thread still has in flight and wait for it to complete, so that no request points into the
+ *  rings or queues once the thread is gone. Then close the rings, which wakes the receivers waiting on them.
+ *
+ *  @param wake_armed True if the poll on the wake pipe is in flight.
+ */
+
+void NetworkInterface::cancel_uring(bool wake_armed){
+    
+	std::vector<uint64_t> pending;
+	if(wake_armed)
+		pending.push_back(uring_tag(URING_WAKE, 0));
+    
+	for(int link = 0; link < children + 1; link++){
+		boost::mutex::scoped_lock lock(d_rings[link].lock);
+		if(d_rings[link].reading)
+			pending.push_back(uring_tag(URING_READ, link));
+	}
+	for(int i = 0; i < children; i++){
+		boost::mutex::scoped_lock lock(d_outbound[i].lock);
+		if(d_outbound[i].sending)
+			pending.push_back(uring_tag(URING_SEND, i));
+	}
+    
+	size_t submitted = 0;
+	size_t completed = 0;
+	while(completed < pending.size()){
+        
+		// Requests are matched on their user_data; the cancel requests themselves complete with user_data 0
+		struct io_uring_sqe *sqe;
+		while(submitted < pending.size() && (sqe = d_uring->get_sqe()) != NULL){
+			sqe->opcode = IORING_OP_ASYNC_CANCEL;
+			sqe->fd = -1;
+			sqe->addr = pending[submitted++];
+			sqe->user_data = 0;
+		}
+        
+		int r = d_uring->submit_and_wait(1);
+		if(r < 0 && r != -EINTR && r != -EAGAIN && r != -EBUSY){
+			errno = -r;
+			perror("NetworkInterface::cancel_uring");
+			break;
+		}
+        
+		struct io_uring_cqe *cqe;
+		while((cqe = d_uring->next_cqe()) != NULL){
+			uint64_t tag = cqe->user_data;
+			int kind = (int)(tag >> 32);
+			int link = (int)(uint32_t)tag;
+			d_uring->cqe_seen();
+            
+			if(tag == 0)
+				continue;
+            
+			if(kind == URING_READ){
+				boost::mutex::scoped_lock lock(d_rings[link].lock);
+				d_rings[link].reading = false;
+			}
+			else if(kind == URING_SEND){
+				boost::mutex::scoped_lock lock(d_outbound[link].lock);
+				d_outbound[link].sending = false;
+			}
+			completed++;
+		}
+	}
+    
+	for(int link = 0; link < children + 1; link++){
+		boost::mutex::scoped_lock lock(d_rings[link].lock);
+		d_rings[link].closed = true;
+		d_rings[link].ready.notify_all();
+	}
+}
+
+/*!
+ *	Start a read into the free space of a link's receive ring, unless one is in flight or the ring is full.
+ */
+
+void NetworkInterface::submit_read(int link){
+    
+	receive_ring &ring = d_rings[link];
+	boost::mutex::scoped_lock lock(ring.lock);
+    
+	if(ring.reading || ring.closed || ring.count == RING_SIZE)
+		return;
+    
+	struct io_uring_sqe *sqe = d_uring->get_sqe();
+	if(sqe == NULL)
+		return; // Try again on the next pass
+    
+	if(ring.count == 0)
+		ring.head = 0; // Empty; start over at the front so the read can be as large as possible
+    
+	size_t tail = (ring.head + ring.count) % RING_SIZE;
+	size_t space = (tail >= ring.head) ? (RING_SIZE - tail) : (ring.head - tail);
+    
+	sqe->opcode = d_fixed_buffers ? IORING_OP_READ_FIXED : IORING_OP_READ;
+	sqe->fd = link_fd(link);
+	sqe->addr = (uint64_t)(uintptr_t)&ring.data[tail];
+	sqe->len = space;
+	sqe->buf_index = link;
+	sqe->user_data = uring_tag(URING_READ, link);
+    
+	ring.reading = true;
+}
+
+/*!
+ *	Start a gather send of the frames queued for a child, unless one is in flight or nothing is queued.
+ */
+
+void NetworkInterface::submit_send(int child_index){
+    
+	outbound_queue &queue = d_outbound[child_index];
+	boost::mutex::scoped_lock lock(queue.lock);
+    
+	if(queue.sending || queue.frames.empty())
+		return;
+    
+	struct io_uring_sqe *sqe = d_uring->get_sqe();
+	if(sqe == NULL)
+		return;
+    
+	// The iovecs and the frames they point to stay put until the send completes; frames are only released by complete_send()
+	memset(&queue.msg, 0, sizeof(queue.msg));
+	queue.msg.msg_iov = queue.iov;
+	queue.msg.msg_iovlen = gather(queue, queue.iov);
+    
+	sqe->opcode = IORING_OP_SENDMSG;
+	sqe->fd = connector->child_fd(child_index);
+	sqe->addr = (uint64_t)(uintptr_t)&queue.msg;
+	sqe->len = 1;
+	sqe->msg_flags = MSG_NOSIGNAL;
+	sqe->user_data = uring_tag(URING_SEND, child_index);
+    
+	queue.sending = true;
+}
+
+/*!
+ *	A read into a receive ring completed: account for the bytes and wake the receiver.
+ *
+ *  @param result The number of bytes read; 0 if the link was closed; -errno on error.
+ */
+
+void NetworkInterface::complete_read(int link, int result){
+    
+	receive_ring &ring = d_rings[link];
+	boost::mutex::scoped_lock lock(ring.lock);
+    
+	ring.reading = false;
+    
+	if(result > 0)
+		ring.count += result;
+	else if(result != -EAGAIN && result != -EINTR){
+		if(result < 0){
+			errno = -result;
+			perror("\t\tNetworkInterface::complete_read");
+		}
+		ring.closed = true;
+	}
+    
+	ring.ready.notify_all();
+}
+
+/*!
+ *	A send to a child completed: release the frames that were written. A failed link drops its queue, as flush() does.
+ *
+ *  @param result The number of bytes written; -errno on error.
+ */
+
+void NetworkInterface::complete_send(int child_index, int result){
+    
+	outbound_queue &queue = d_outbound[child_index];
+	boost::mutex::scoped_lock lock(queue.lock);
+    
+	queue.sending = false;
+    
+	if(result >= 0)
+		release(queue, result);
+	else if(result != -EAGAIN && result != -EINTR){
+		errno = -result;
+		perror("NetworkInterface::complete_send");
+		queue.frames.clear();
+		queue.bytes = 0;
+	}
+}
+
+/*!
+ *	Writer thread: wait until a child with queued frames can take more bytes, and write as many frames to it as its socket takes.
+ *  A slow child only holds up its own queue.
+ */
+
+void NetworkInterface::write_loop(){
+    
+	std::vector<struct pollfd> fds;
+	std::vector<int> indexes;
+    
+	gr::router::place_thread(gr::router::ROLE_WRITER, 0);
+    
+	while(!d_writer_done){
+        
+		fds.clear();
+		indexes.clear();
+        
+		struct pollfd wake = {d_wake_pipe[0], POLLIN, 0};
+		fds.push_back(wake);
+        
+		// Only poll the children with something to write
+		for(int i = 0; i < children; i++){
+			if(queued_bytes(i) > 0){
+				struct pollfd p = {connector->child_fd(i), POLLOUT, 0};
+				fds.push_back(p);
+				indexes.push_back(i);
+			}
+		}
+        
+		if(poll(&fds[0], fds.size(), 100) < 0 && errno != EINTR){
+			perror("NetworkInterface::write_loop");
+			return;
+		}
+        
+		if(fds[0].revents & POLLIN){
+			char drain[64];
+			while(read(d_wake_pipe[0], drain, sizeof(drain)) > 0)
+				;
+		}
+        
+		for(size_t i = 1; i < fds.size(); i++){
+			if(fds[i].revents & (POLLOUT | POLLERR | POLLHUP))
+				flush(indexes[i - 1]);
+		}
+	}
+}
+
+/*!
+ *	Write as many queued frames to the child at child_index as its socket takes, with one gather write.
+ *
+ *  @return bool False if the link failed; its queued frames are dropped.
+ */
+
+bool NetworkInterface::flush(int child_index){
+    
+	outbound_queue &queue = d_outbound[child_index];
+	boost::mutex::scoped_lock lock(queue.lock);
+    
+	struct iovec iov[3 * MAX_GATHER_FRAMES];
+	int count = gather(queue, iov);
+    
+	if(count == 0)
+		return true;
+    
+	ssize_t r = connector->writev_child(child_index, iov, count);
+    
+	if(r < 0){
+		if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			return true;
+        
+		perror("NetworkInterface::flush");
+		queue.frames.clear();
+		queue.bytes = 0;
+		return false;
+	}
+    
+	release(queue, r);
+	return true;
+}
+
+/*!
+ *	Point iov at the unwritten parts of the first MAX_GATHER_FRAMES queued frames; the caller holds the queue lock.
+ *
+ *  @return The number of buffers in iov.
+ */
+
+int NetworkInterface::gather(outbound_queue &queue, struct iovec *iov){
+    
+	int count = 0;
+    
+	for(size_t f = 0; f < queue.frames.size() && f < (size_t)MAX_GATHER_FRAMES; f++){
+        
+		outbound_frame &frame = queue.frames[f];
+		const char *parts[3] = {frame.header, frame.body, frame.trailer};
+		size_t sizes[3] = {FRAME_HEADER_SIZE, frame.size, frame.trailer_size};
+		size_t skip = frame.written; // Only the first frame can be partly written
+        
+		for(int p = 0; p < 3; p++){
+			if(skip >= sizes[p]){
+				skip -= sizes[p];
+				continue;
+			}
+			iov[count].iov_base = (void *)(parts[p] + skip);
+			iov[count].iov_len = sizes[p] - skip;
+			count++;
+			skip = 0;
+		}
+	}
+    
+	return count;
+}
+
+/*!
+ *	Account for written bytes at the front of a queue, and release the frames that have been written completely; the caller holds the queue lock.
+ */
+
+void NetworkInterface::release(outbound_queue &queue, size_t written){
+    
+	queue.bytes -= written;
+    
+	while(written > 0){
+		outbound_frame &frame = queue.frames.front();
+		size_t left = FRAME_HEADER_SIZE + frame.size + frame.trailer_size - frame.written;
+        
+		if(written < left){
+			frame.written += written;
+			break;
+		}
+		written -= left;
+		queue.frames.pop_front();
+	}
+}
+
+/*!
+ *	Receive exactly size bytes; the caller holds the lock of the link's receive ring.
+ *  Large reads go straight into buf once the ring is drained, so big segments are only copied once
+ *  (with io_uring, everything goes through the ring).
+ *
+ *  @return bool True if all of the bytes were received; False if the link was closed.
+ */
+
+bool NetworkInterface::read_exact(int child_index, char *buf, int size){
+    
+	int nread = consume(child_index, buf, size);
+    
+	while(nread < size){
+        
+		if(size - nread >= RING_SIZE / 4 && !d_uring){
+			int r = read_socket(child_index, &buf[nread], size - nread);
+			if(r <= 0)
+				return false;
+			nread += r;
+		}
+		else{
+			if(!fill(child_index))
+				return false;
+			nread += consume(child_index, &buf[nread], size - nread);
+		}
+	}
+	return true;
+}
+
+/*!
+ *	Receive one framed message. If the frame boundary has been lost, scan forward to the next sync word.
+ *
+ *  @param child_index Index of the node to receive from; -1 for parent; >= 0 for child
+ *  @param &body The vector the message is written to (without the checksum).
+ *  @param checksum True if the frames carry a CRC32C trailer.
+ *  @return 1 if a frame was received intact; 0 if a corrupted frame was dropped; -1 if the link was closed.
+ */
+
+int NetworkInterface::receive_frame(int child_index, std::vector<char> &body, bool checksum){
+    
+	boost::mutex::scoped_lock lock(d_rings[child_index + 1].lock); // One frame at a time per link
+    
+	link_counters &counters = d_counters[child_index + 1];
+	int min_length = checksum ? 5 : 1; // Every message has at least its type byte, in front of the checksum
+    
+	char header[FRAME_HEADER_SIZE];
+	if(!read_exact(child_index, header, FRAME_HEADER_SIZE))
+		return -1;
+    
+	int length = gr::router::get_int32(&header[4]);
+	bool lost = false;
+    
+	// Slide over the stream one byte at a time until a sync word with a sane length shows up
+	while(memcmp(header, FRAME_SYNC, 4) != 0 || length < min_length || length > FRAME_MAX_SIZE){
+        
+		if(!lost){
+			lost = true;
+			counters.resyncs++;
+			std::cout << "ERROR: Lost the frame boundary on link " << child_index << "; resynchronizing (" << counters.resyncs << " so far)" << std::endl;
+		}
+        
+		memmove(&header[0], &header[1], FRAME_HEADER_SIZE - 1);
+		if(!read_exact(child_index, &header[FRAME_HEADER_SIZE - 1], 1))
+			return -1;
+        
+		counters.skipped_bytes++;
+		length = gr::router::get_int32(&header[4]);
+	}
+    
+	body.resize(length);
+	if(length > 0 && !read_exact(child_index, &body[0], length))
+		return -1;
+    
+	if(checksum){
+		int size = length - 4;
+		uint32_t crc = gr::router::crc32c(gr::router::crc32c(0, header, FRAME_HEADER_SIZE), &body[0], size);
+        
+		if((uint32_t)gr::router::get_int32(&body[size]) != crc){
+			counters.checksum_errors++;
+			std::cout << "ERROR: Dropping a corrupted frame on link " << child_index << " (" << counters.checksum_errors << " so far)" << std::endl;
+            
+			// The length may be what was corrupted, and the body may hold the next frames; scan again from the byte after the sync
+			// word (the bytes not consumed from an earlier replay still follow these ones)
+			receive_ring &ring = d_rings[child_index + 1];
+			std::vector<char> replay(&header[1], &header[FRAME_HEADER_SIZE]);
+			replay.insert(replay.end(), body.begin(), body.end());
+			replay.insert(replay.end(), ring.replay.begin() + ring.replay_at, ring.replay.end());
+			ring.replay.swap(replay);
+			ring.replay_at = 0;
+			return 0;
+		}
+		body.resize(size);
+	}
+    
+	counters.frames++;
+	return 1;
+}
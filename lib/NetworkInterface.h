@@ -30,6 +30,12 @@
 #include <stdexcept>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <boost/shared_ptr.hpp>
+#include <boost/atomic.hpp>
+#include <sys/socket.h>
 #include "EthernetConnector.h"
 
 #ifdef HAVE_IO_H
@@ -38,29 +44,131 @@
 
 #define V   false
 
+// Counters kept for every link; see NetworkInterface::counters()
+namespace gr { namespace router { class uring; } }
+
+struct link_counters{
+	uint64_t frames; // Frames received intact
+	uint64_t resyncs; // Times the frame boundary was lost and the receiver scanned for the next sync word
+	uint64_t skipped_bytes; // Bytes thrown away while scanning
+	uint64_t checksum_errors; // Frames dropped because their CRC32C did not match
+	uint64_t malformed; // Frames dropped because their contents did not parse
+};
+
 class NetworkInterface{
 public:
     
 	// Default Constructor/Destructor
-	NetworkInterface(int itemsize, int children, int port, bool root);
+	NetworkInterface(int itemsize, int children, int port, bool root, const gr::router::connection_options &options = gr::router::connection_options());
 	~NetworkInterface();
     
     // Build connection graph
     bool connect(char* parent_hostname);
     
+    // Wake every thread waiting on a link and make the links fail from now on; safe to call more than once
+    void stop();
+    
     // Receive
     int receive(int child_index, char * outbuf, int noutput_items);
     
     // Send msg to child at index child_index
     int send(int child_index, char* msg, int num);
     
+    // Send one framed message; with checksum, a CRC32C trailer is appended
+    bool send_frame(int child_index, const char *body, int size, bool checksum);
+    
+    // Queue one framed message for the child at child_index without blocking; owner keeps body alive until it is written
+    void queue_frame(int child_index, const char *body, int size, bool checksum, boost::shared_ptr<void> owner);
+    
+    // Bytes queued for the child at child_index that have not been written yet
+    size_t queued_bytes(int child_index);
+    
+    // Start the thread that writes the queued frames
+    void start_writer();
+    
+    // Receive the next intact frame (1), a corrupted frame that was dropped (0), or the link was closed (-1)
+    int receive_frame(int child_index, std::vector<char> &body, bool checksum);
+    
+    // Count a frame that arrived intact, but did not parse
+    void count_malformed(int child_index){ d_counters[child_index + 1].malformed++; }
+    
+    // Place the calling thread as the receiver of child_index (-1 for parent); see affinity.h
+    void pin_receiver(int child_index);
+    
+    // Counters of the link to the child at child_index (-1 for parent)
+    const link_counters& counters(int child_index) const { return d_counters[child_index + 1]; }
+    
 private:
     
+    // Receive buffer of one link; bytes [head, head + count) (modulo RING_SIZE) have been received but not consumed
+    struct receive_ring{
+        char *data;
+        size_t head;
+        size_t count;
+        boost::mutex lock; // Held while a thread reads from the link
+        
+        // Bytes of a frame that failed its checksum, handed back to be scanned again for a sync word; read before the ring
+        std::vector<char> replay;
+        size_t replay_at;
+        
+        // io_uring transport only
+        bool reading; // A read into the free space is in flight
+        bool closed; // The link was closed or failed
+        boost::condition_variable_any ready; // Signalled when a read completes
+    };
+    
+    static const int RING_SIZE = 256 * 1024;
+    
+    // A frame waiting to be written to a child
+    struct outbound_frame{
+        char header[8];
+        const char *body;
+        size_t size;
+        char trailer[4];
+        size_t trailer_size;
+        size_t written; // Bytes of header, body and trailer written so far
+        boost::shared_ptr<void> owner; // Keeps the body alive until it has been written
+    };
+    
+    static const int MAX_GATHER_FRAMES = 64; // Frames per gather write
+    
+    // Frames waiting to be written to one child
+    struct outbound_queue{
+        std::deque<outbound_frame> frames;
+        size_t bytes; // Bytes queued, not written yet
+        boost::mutex lock;
+        
+        // io_uring transport only; the send in flight points here
+        bool sending;
+        struct iovec iov[3 * MAX_GATHER_FRAMES];
+        struct msghdr msg;
+    };
+    
     // Private functions
-    int read_items(int child_index, char *buf, int nitems);
-    int handle_residue(char *buf, int nbytes_read);
-    void flush_residue(){d_residue_len = 0; }
+    int read_socket(int child_index, char *buf, int size);
+    bool fill(int child_index);
+    int consume(int child_index, char *buf, int size);
+    bool read_exact(int child_index, char *buf, int size);
+    void write_header(char *header, int size, bool checksum);
+    void write_loop();
+    bool flush(int child_index);
+    int gather(outbound_queue &queue, struct iovec *iov);
+    void release(outbound_queue &queue, size_t written);
+    void wake_writer();
+    void start_io();
     
+    // io_uring transport
+    bool start_uring();
+    void io_loop();
+    void submit_read(int link);
+    void submit_send(int child_index);
+    void complete_read(int link, int result);
+    void complete_send(int child_index, int result);
+    int link_fd(int link);
+    void cancel_uring(bool wake_armed);
+    
+    // Wait until the link to child_index (-1 for parent) is ready for events; false once stop() has been called
+    bool wait_link(int child_index, short events);
     
     EthernetConnector *connector;
     int children;
@@ -68,9 +176,25 @@ private:
     bool root;
     size_t d_itemsize; //# Size of the items to be sent/received
     
-    // For receiving
-    unsigned char *d_residue;
-    unsigned long d_residue_len;
+    // For receiving; index 0 is the parent, index i + 1 is child i
+    receive_ring *d_rings;
+    
+    // For sending to the children once the writer is started
+    outbound_queue *d_outbound;
+    boost::shared_ptr< boost::thread > d_writer;
+    boost::atomic<bool> d_writer_done;
+    int d_wake_pipe[2]; // Written to wake the writer when frames are queued
+    
+    // Readable once stop() has been called; in every poll on a link
+    int d_stop_fd;
+    boost::atomic<bool> d_stopped;
+    
+    // io_uring transport; NULL when the sockets are used directly
+    gr::router::uring *d_uring;
+    bool d_fixed_buffers; // The receive rings are registered with the ring
+    
+    // Link counters; index 0 is the parent, index i + 1 is child i
+    link_counters *d_counters;
 };
 
 #endif
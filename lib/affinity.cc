@@ -0,0 +1,238 @@
+/* -*- c++ -*- */
+/*
+ *  Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "affinity.h"
+#include <string>
+#include <vector>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+#define VERBOSE false
+
+// Same value as in <numaif.h>; we call set_mempolicy directly rather than depend on libnuma
+#define ROUTER_MPOL_PREFERRED 1
+
+namespace gr {
+    namespace router {
+        
+        static const char *role_names[ROLE_COUNT] = {"send", "receive", "writer"};
+        
+        // Parsed GR_ROUTER_AFFINITY
+        struct placement {
+            std::vector<int> cpus[ROLE_COUNT];
+            std::vector<int> node_cpus; // CPUs of the NUMA node
+            int node; // -1 if no node was given
+        };
+        
+        /*!
+         *  Parse a CPU list such as "0-3,8" and append the CPUs to cpus.
+         *
+         *  @return False if the list does not parse.
+         */
+        
+        static bool parse_cpu_list(const char *list, std::vector<int> &cpus){
+            
+            const char *p = list;
+            
+            while(*p != '\0' && *p != '\n'){
+                char *end;
+                long first = strtol(p, &end, 10);
+                if(end == p || first < 0)
+                    return false;
+                
+                long last = first;
+                p = end;
+                
+                if(*p == '-'){
+                    last = strtol(p + 1, &end, 10);
+                    if(end == p + 1 || last < first)
+                        return false;
+                    p = end;
+                }
+                
+                for(long cpu = first; cpu <= last; cpu++)
+                    cpus.push_back((int)cpu);
+                
+                if(*p == ',')
+                    p++;
+                else if(*p != '\0' && *p != '\n')
+                    return false;
+            }
+            return true;
+        }
+        
+        /*!
+         *  Read the CPUs of a NUMA node from sysfs.
+         */
+        
+        static bool node_cpu_list(int node, std::vector<int> &cpus){
+            
+            char path[64];
+            snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+            
+            FILE *file = fopen(path, "r");
+            if(file == NULL)
+                return false;
+            
+            char line[1024];
+            bool ok = (fgets(line, sizeof(line), file) != NULL) && parse_cpu_list(line, cpus);
+            fclose(file);
+            return ok;
+        }
+        
+        static placement read_placement(){
+            
+            placement p;
+            p.node = -1;
+            
+            const char *config = getenv("GR_ROUTER_AFFINITY");
+            if(config == NULL)
+                return p;
+            
+            std::string fields(config);
+            size_t start = 0;
+            
+            while(start < fields.size()){
+                size_t end = fields.find_first_of(" ;", start);
+                if(end == std::string::npos)
+                    end = fields.size();
+                
+                std::string field = fields.substr(start, end - start);
+                start = end + 1;
+                
+                if(field.empty())
+                    continue;
+                
+                size_t equals = field.find('=');
+                std::string key = field.substr(0, equals);
+                std::string value = (equals == std::string::npos) ? "" : field.substr(equals + 1);
+                
+                bool known = false;
+                
+                for(int role = 0; role < ROLE_COUNT; role++){
+                    if(key == role_names[role]){
+                        known = true;
+                        if(!parse_cpu_list(value.c_str(), p.cpus[role])){
+                            std::cout << "ERROR: GR_ROUTER_AFFINITY: bad CPU list for " << key << ": " << value << std::endl;
+                            p.cpus[role].clear();
+                        }
+                    }
+                }
+                
+                if(key == "numa"){
+                    known = true;
+                    p.node = atoi(value.c_str());
+                    if(p.node < 0 || p.node >= 1024 || !node_cpu_list(p.node, p.node_cpus)){
+                        std::cout << "ERROR: GR_ROUTER_AFFINITY: no such NUMA node: " << value << std::endl;
+                        p.node = -1;
+                        p.node_cpus.clear();
+                    }
+                }
+                
+                if(!known)
+                    std::cout << "ERROR: GR_ROUTER_AFFINITY: unknown field: " << field << std::endl;
+            }
+            
+            return p;
+        }
+        
+        static const placement& configured_placement(){
+            static placement configured = read_placement();
+            return configured;
+        }
+        
+        /*!
+         *  Pin the calling thread to one CPU.
+         *
+         *  @param cpu The CPU to run on.
+         *  @return True if the thread was pinned; False if the OS refused (a warning is printed).
+         */
+        
+        bool pin_thread_to_cpu(int cpu){
+#ifdef __linux__
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            
+            int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+            if(error != 0){
+                std::cout << "Warning: Could not pin a router thread to CPU " << cpu << ": " << strerror(error) << std::endl;
+                return false;
+            }
+            return true;
+#else
+            return false;
+#endif
+        }
+        
+        /*!
+         *  Place the calling thread as GR_ROUTER_AFFINITY asks: pin it to its CPU, and make it allocate from the NUMA node.
+         *
+         *  @param role The thread_role of the calling thread.
+         *  @param number The number of the calling thread among the threads of its role.
+         */
+        
+        void place_thread(int role, int number){
+#ifdef __linux__
+            const placement &p = configured_placement();
+            const std::vector<int> &cpus = p.cpus[role];
+            
+            if(!cpus.empty()){
+                pin_thread_to_cpu(cpus[number % cpus.size()]);
+            }
+            else if(!p.node_cpus.empty()){
+                // No CPUs for this role; let the thread run anywhere on the node
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                for(size_t i = 0; i < p.node_cpus.size(); i++)
+                    CPU_SET(p.node_cpus[i], &set);
+                
+                int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+                if(error != 0)
+                    std::cout << "Warning: Could not confine a router thread to NUMA node " << p.node << ": " << strerror(error) << std::endl;
+            }
+            
+            // Pages are placed when they are first touched, so this covers the segments and receive rings the thread fills; not the
+            // segments the queue sinks fill on the GNU Radio scheduler's threads (see affinity.h)
+            if(p.node >= 0){
+                unsigned long mask[16];
+                memset(mask, 0, sizeof(mask));
+                mask[p.node / (8 * sizeof(unsigned long))] = 1UL << (p.node % (8 * sizeof(unsigned long)));
+                
+                if(syscall(SYS_set_mempolicy, ROUTER_MPOL_PREFERRED, mask, 8 * sizeof(mask)) != 0)
+                    perror("Warning: Could not prefer memory from the NUMA node");
+            }
+            
+            if(VERBOSE)
+                std::cout << "Placed " << role_names[role] << " thread " << number << std::endl;
+#endif
+        }
+        
+    } /* namespace router */
+} /* namespace gr */
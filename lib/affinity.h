@@ -0,0 +1,60 @@
+/* -*- c++ -*- */
+/*
+ *  Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_ROUTER_AFFINITY_H
+#define INCLUDED_ROUTER_AFFINITY_H
+
+/*
+ CPU and NUMA placement of the router threads.
+
+ The placement comes from the GR_ROUTER_AFFINITY environment variable, a list of key=value fields, e.g.
+   GR_ROUTER_AFFINITY="numa=1 send=8-11 receive=12-15 writer=16"
+ send, receive and writer are CPU lists (as in /sys: "0-3,8"). The n-th thread of a role is pinned to the
+ n-th CPU of its list, wrapping around. numa confines the threads of every role without a list to the CPUs of
+ that node, and makes every router thread allocate from that node, so the segments and receive rings a thread
+ fills stay on the same socket as the thread. With the variable unset, threads are left where the OS puts them.
+
+ Only the router's own threads are placed. The input segments of the root are allocated and filled by the queue
+ sink, on a thread of the GNU Radio scheduler, and so are the results of a child; those threads (and the memory
+ they allocate) stay where the OS puts them. To keep them on the node too, start the flow graph under
+ numactl --cpunodebind=N --membind=N.
+ */
+
+namespace gr {
+    namespace router {
+        
+        // Roles of the router threads
+        enum thread_role {
+            ROLE_SEND = 0, // root sender workers, child send_root
+            ROLE_RECEIVE = 1, // root receivers (one per child), child receive_root
+            ROLE_WRITER = 2, // root writer thread
+            ROLE_COUNT = 3
+        };
+        
+        // Place the calling thread, the number-th thread of its role
+        void place_thread(int role, int number);
+        
+        // Pin the calling thread to one CPU; false (with a warning) if the OS refused
+        bool pin_thread_to_cpu(int cpu);
+        
+    } // namespace router
+} // namespace gr
+
+#endif /* INCLUDED_ROUTER_AFFINITY_H */
@@ -30,6 +30,11 @@
 
 #include <gnuradio/io_signature.h>
 #include "child_impl.h"
+#include "wire_format.h"
+#include "segment_traits.h"
+#include "tag_table.h"
+#include "affinity.h"
+#include <algorithm>
 
 #define VERBOSE     false
 
@@ -45,13 +50,36 @@ namespace gr {
          *  @param &input_queue A pointer to the input lockfree queue, where segments sent from the parent will be pushed.
          *  @param &output_queue A pointer to the output lockfree queue, where completed segments will be pulled from to send to the parent.
          *  @param throughput The maximum rate at which the child router will pull from the output queue. (Not currently being used)
+         *  @param options The socket options of the link to the parent.
          *  @return A shared pointer to the child router block.
          */
         
         child::sptr
- 		child::make(int number_of_children, int child_index, char * hostname, boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > &input_queue, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &output_queue, double throughput)
+ 		child::make(int number_of_children, int child_index, char * hostname, boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > &input_queue, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &output_queue, double throughput, const connection_options &options)
  		{
- 			return gnuradio::get_initial_sptr (new child_impl(number_of_children, child_index, hostname, input_queue, output_queue, throughput));
+            std::vector< boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> >* > input_queues(1, &input_queue);
+            std::vector< boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> >* > output_queues(1, &output_queue);
+            
+ 			return gnuradio::get_initial_sptr (new child_impl(number_of_children, child_index, hostname, input_queues, output_queues, throughput, options));
+ 		}
+        
+        /*!
+         *  This is the public constructor for a child router block with several local pipelines.
+         *
+         *  @param number_of_children The number of children that the child router has. (0 for now)
+         *  @param child_index The index of this child.
+         *  @param hostname The hostname (or ip address) of the child's parent.
+         *  @param &input_queues The input queue of each pipeline, where the segments sent from the parent will be pushed.
+         *  @param &output_queues The output queue of each pipeline, where completed segments will be pulled from to send to the parent.
+         *  @param throughput The maximum rate at which the child router will pull from the output queues. (Not currently being used)
+         *  @param options The socket options of the link to the parent.
+         *  @return A shared pointer to the child router block.
+         */
+        
+        child::sptr
+ 		child::make(int number_of_children, int child_index, char * hostname, const std::vector< boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> >* > &input_queues, const std::vector< boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> >* > &output_queues, double throughput, const connection_options &options)
+ 		{
+ 			return gnuradio::get_initial_sptr (new child_impl(number_of_children, child_index, hostname, input_queues, output_queues, throughput, options));
  		}
         
         /*!
@@ -60,17 +88,28 @@ namespace gr {
          *  @param number_of_children The number of children that the child router has. (0 for now)
          *  @param child_index The index of this child.
          *  @param hostname The hostname (or ip address) of the child's parent.
-         *  @param &input_queue A pointer to the input lockfree queue, where segments sent from the parent will be pushed.
-         *  @param &output_queue A pointer to the output lockfree queue, where completed segments will be pulled from to send to the parent.
-         *  @param throughput The maximum rate at which the child router will pull from the output queue. (Not currently being used)
+         *  @param &input_queues The input queue of each pipeline, where segments sent from the parent will be pushed.
+         *  @param &output_queues The output queue of each pipeline, where completed segments will be pulled from to send to the parent.
+         *  @param throughput The maximum rate at which the child router will pull from the output queues. (Not currently being used)
+         *  @param options The socket options of the link to the parent.
          */
         
-        child_impl::child_impl( int numberofchildren, int index, char * hostname, boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > &input_queue, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &output_queue, double throughput)
+        child_impl::child_impl( int numberofchildren, int index, char * hostname, const std::vector< boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> >* > &input_queues, const std::vector< boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> >* > &output_queues, double throughput, const connection_options &options)
         : gr::sync_block("child",
                          gr::io_signature::make(0, 0, 0),
-                         gr::io_signature::make(0, 0, 0)), in_queue(&input_queue), out_queue(&output_queue), child_index(index), global_counter(0), parent_hostname(hostname), number_of_children(numberofchildren), d_finished(false), d_throughput(throughput)
+                         gr::io_signature::make(0, 0, 0)), in_queues(input_queues), out_queues(output_queues), last_pipeline(0), d_steal_depth(0), kill_received(false), kill_forwarded(false), steal_request(-1), next_result(0), child_index(index), global_counter(0), parent_hostname(hostname), number_of_children(numberofchildren), d_finished(false), d_throughput(throughput)
         {
             
+            // A pipeline needs both of its queues
+            if(in_queues.size() != out_queues.size())
+                std::cout << "ERROR: The child router needs as many output queues as input queues" << std::endl;
+            
+            number_of_pipelines = (int)std::min(in_queues.size(), out_queues.size());
+            
+            pipeline_outstanding = new boost::atomic<int>[number_of_pipelines];
+            for(int i = 0; i < number_of_pipelines; i++)
+                pipeline_outstanding[i] = 0;
+            
             
             if(VERBOSE)
                 myfile.open("child_router.data");
@@ -79,11 +118,14 @@ namespace gr {
             if(VERBOSE)
                 myfile << "Attempting to connect to parent\n";
             
-            connector = new NetworkInterface(sizeof(char), 0, 8080, false);
+            connector = new NetworkInterface(sizeof(char), 0, 8080, false, options);
             
             // Interconnect all blocks (hostname of Root)
             connector->connect(hostname);
             
+            // Agree on the wire codecs before any segments arrive
+            negotiate();
+            
             if(VERBOSE){
                 myfile << "Connected to parent\n";
                 std::cout << "\tChild Router Finished connecting to hostname=" << hostname << std::endl;
@@ -125,6 +167,7 @@ namespace gr {
             }
             
      	    d_finished = true;
+            connector->stop(); // Wakes the threads blocked on the link
             
      	    // Kill send thread
      	    d_thread_send_root->interrupt();
@@ -135,6 +178,11 @@ namespace gr {
      	    d_thread_receive_root->join();
             
             delete connector;
+            delete[] pipeline_outstanding;
+            
+            // Segments held back that were never started
+            for(size_t i = 0; i < backlog.size(); i++)
+                delete backlog[i];
         }
         
         /**
@@ -147,7 +195,10 @@ namespace gr {
                          gr_vector_void_star &output_items)
         {
             // This block is completely asynchronous; therefore there is no need for 'work()'ing
-            // Might want to put something else in here; not sure yet.
+            // It is done once the end of the stream has been passed back to the parent
+            if(d_finished)
+                return -1;
+            
             return 0;
         }
         
@@ -158,81 +209,102 @@ namespace gr {
         
         void child_impl::receive_root(){
             
-            char * temp_header_bytes = new char[3*sizeof(float)]; // Grab the first three header values
-            char * temp_buffer;
-     	    float * buffer;
+            std::vector<char> frame; // Body of the current frame
             std::vector<float> *arrival;
-            int size;
+            
+            connector->pin_receiver(-1);
             
      	    while(!d_finished){
                 
-                // Calling the blocking receive; receive array of bytes
-                size = 0;
-                while(size < (3*sizeof(float))){
-                    size += connector->receive(-1, &(temp_header_bytes[0]), (3*sizeof(float)-size));
-                    if(size == 0 && d_finished){
-                        delete[] temp_header_bytes;
-                        continue;
-                    }
-                }
+                // Calling the blocking receive; receive one frame
+                int status = connector->receive_frame(-1, frame, checksum);
                 
-                float packet_type; // The message type of the current segment
-                memcpy(&packet_type, &(temp_header_bytes[0]), 4);
+                if(status < 0)
+                    break; // The link was closed
+                if(status == 0)
+                    continue; // A corrupted frame was dropped; the next one is intact again
                 
-                float index; // Index of the current segment
-                memcpy(&index, &(temp_header_bytes[4]), 4);
+                if(frame.size() < 3*sizeof(float)){
+                    std::cout << "ERROR: Dropping a malformed segment from the parent" << std::endl;
+                    connector->count_malformed(-1);
+                    continue;
+                }
                 
-                float data_size; // size in floats
-                memcpy(&data_size, &(temp_header_bytes[8]), 4);
+                float packet_type = get_float(&(frame[0])); // The message type of the current segment
+                float index = get_float(&(frame[4])); // Index of the current segment
+                float data_size = get_float(&(frame[8])); // size in floats
                 
                 // Switch on packet type and parse messages; only type 1 is current supported
                 switch((int)packet_type){
                     case 1:
-                        temp_buffer = new char[(int)data_size*sizeof(float)];
-                        buffer = new float[(int)data_size];
-                        size = 0;
+                    {
+                        // Every codec takes at least a byte per sample; check the size against the frame before using it
+                        if(!(data_size >= 0 && data_size <= (float)frame.size())){
+                            std::cout << "ERROR: Dropping a malformed segment from the parent" << std::endl;
+                            connector->count_malformed(-1);
+                            break;
+                        }
                         
-                        // Wait for the rest of the message bytes
-                        while(size < ((int)data_size*sizeof(float)))
-                            size += connector->receive(-1, &(temp_buffer[size]), ((int)data_size*sizeof(float)-size)); // Receive the rest of the segment
+                        int wire_size = encoded_samples_size(sample_codec, (int)data_size); // Bytes of samples on the wire
                         
-                        memcpy(&buffer[0], &temp_buffer[0], (int)data_size*sizeof(float));
+                        // The samples, then the tag table (if any)
+                        if((int)frame.size() < 3*(int)sizeof(float) + wire_size){
+                            std::cout << "ERROR: Dropping a malformed segment from the parent" << std::endl;
+                            connector->count_malformed(-1);
+                            break;
+                        }
                         
                         // Rebuild float vectors and push those into the input queue
                         arrival = new std::vector<float>();
+                        arrival->reserve(3 + (int)data_size);
                         arrival->push_back(packet_type);
                         arrival->push_back(index);
                         arrival->push_back(data_size);
-                        arrival->insert(arrival->end(), &buffer[0], &buffer[(int)data_size]);
+                        arrival->resize(3 + (int)data_size);
                         
-                        // Keep attempting to push the segment until successful (may want to make this more efficient)
-                        while(!in_queue->push(arrival))
-                            ;
+                        if(data_size > 0)
+                            decode_samples(sample_codec, &(frame[3*sizeof(float)]), (int)data_size, &((*arrival)[3]));
                         
-                        // Keep incrementing the number of segments being used (change this)
-                        for(int i = 0; i < (data_size/1024); i++)
-                            increment();
+                        append_tag_table(*arrival, std::vector<char>(frame.begin() + 3*sizeof(float) + wire_size, frame.end()));
+                        
+                        // One more segment outstanding
+                        increment(1);
+                        
+                        // Hand the segment to the least loaded pipeline, or hold it back where the parent can steal it
+                        if(d_steal_depth > 0){
+                            backlog_lock.lock();
+                            backlog.push_back(arrival);
+                            feed_pipelines();
+                            backlog_lock.unlock();
+                        }
+                        else{
+                            push_pipeline(min_pipeline(), arrival);
+                        }
                         
                         break;
+                    }
                     case 2:
                         std::cout << "ERROR: Right now we're not supporting this format" << std::endl;
                         break;
                     case 3:
-                        arrival = new std::vector<float>();
-                        arrival->push_back(3);
-                        
-                        while(!in_queue->push(arrival))
-                            ;
+                        // End of stream; the flow graph behind every input queue finishes, and its kill message comes back through its output queue
+                        backlog_lock.lock();
+                        kill_received = true;
+                        feed_pipelines(); // Behind the backlog
+                        backlog_lock.unlock();
                         
+                        return; // Nothing else comes from the parent
+                    case 6:
+                        // The parent wants segments back for an idle sibling; the send thread answers, so the answer is not interleaved with a result
+                        steal_request.store((int)index, boost::memory_order_release); // The count is in the index field
                         break;
                     default:
-                        myfile << "ERROR: Got a message of unexpected type" << std::endl;
+                        std::cout << "ERROR: Got a message of unexpected type " << (int)packet_type << " from the parent" << std::endl;
+                        connector->count_malformed(-1);
                         
                 }
             }
             
-            delete[] temp_header_bytes;
-            
         }
         
         
@@ -243,11 +315,20 @@ namespace gr {
         void child_impl::send_root(){
             
             std::vector<char> *temp; // Pointer to current vector of bytes to be sent
-            int sent = 0;
+            int pipeline; // Pipeline the current vector came from
+            
+            std::vector<bool> finished(number_of_pipelines, false); // Pipelines whose kill message came back
+            int pipelines_finished = 0;
+            
+            place_thread(ROLE_SEND, 0);
             
             // Until the thread is killed, keep sending
      	    while(!d_finished){
                 
+                // Answer the parent's request for segments before sending the next result
+                int steal_count = steal_request.exchange(-1, boost::memory_order_acquire);
+                if(steal_count >= 0)
+                    give_back(steal_count);
                 
                 // This is an internal throttle; it is not being used yet.
                 // Throughput Stuff------
@@ -263,45 +344,73 @@ namespace gr {
                 //----------
                 
                 
-                // If there is a segment in the output queue, pop it and send it
-                if(out_queue->pop(temp)){
+                // If there is a segment in an output queue, pop it and send it
+                if(pop_result(temp, pipeline, finished)){
                     
                     char packet_type = temp->at(0); // Get the packet type
                     
-                    float index; // Get the packet index
-                    memcpy(&index, &(temp->at(1)), 4);
-                    
-                    float data_size; // Get the packet data_size
-                    memcpy(&data_size, &(temp->at(5)), 4);
-                    
-                    float num_windows = data_size / 50;
-                    float packet_size = data_size + 1 + 2 * sizeof(float);
-                    
                     //Switch on the packet_type
                     switch(packet_type){
                         case '2':
                         {
+                            float index = segment_traits<char>::index(*temp); // Get the packet index
+                            float data_size = segment_traits<char>::size(*temp); // Get the packet data_size
+                            float packet_size = data_size + 1 + 2 * sizeof(float);
                             
                             d_total_samples += data_size;
                             
                             // Shove on a weight value, and make it a type-2 message
                             
-                            int weight = get_weight(); // Grab the current weight of the child
+                            float weight = get_weight(); // Grab the current weight of the child; the root reads it as a float
                             
                             char* weight_bytes = new char[4];
-                            memcpy(weight_bytes, &weight, 4);
+                            put_float(weight_bytes, weight);
+                            
+                            // The tag table goes behind the weight
+                            size_t table_size;
+                            const char *table = segment_tag_table(*temp, table_size);
+                            std::vector<char> tags(table, table + table_size);
+                            temp->resize(9 + (int)data_size);
                             
-                            temp->insert(temp->end(), &(weight_bytes[0]), &(weight_bytes[4]));
                             temp->at(0) = '3'; // Change to type 3 message
+                            put_float(&(temp->at(1)), index); // Index and size go on the wire little-endian
+                            put_float(&(temp->at(5)), data_size);
+                            words_wire_order(&((*temp)[9]), (int)data_size, result_word_size); // The data goes little-endian too, word by word
+                            
+                            // Compress the data field; the compressed size goes in front of it
+                            if(result_codec == CODEC_LZ){
+                                std::vector<char> *compressed = new std::vector<char>(temp->begin(), temp->begin() + 9);
+                                compressed->resize(13);
+                                
+                                lz_compress(&((*temp)[9]), (int)data_size, *compressed);
+                                
+                                int compressed_size = compressed->size() - 13;
+                                put_int32(&((*compressed)[9]), compressed_size);
+                                
+                                delete temp;
+                                temp = compressed;
+                                packet_size = temp->size();
+                            }
+                            
+                            temp->insert(temp->end(), &(weight_bytes[0]), &(weight_bytes[4]));
+                            delete[] weight_bytes;
                             
                             packet_size += 4; // Increment the packet size; we're adding a weight
                             
-                            sent = 0;
-                            while(sent < packet_size)
-                                sent += connector->send(-1, &((temp->data())[sent]), (packet_size-sent)); // *4
+                            temp->insert(temp->end(), tags.begin(), tags.end());
+                            packet_size += tags.size();
                             
-                            for(int i = 0; i < num_windows; i++)
-                                decrement();
+                            connector->send_frame(-1, temp->data(), packet_size, checksum);
+                            
+                            decrement(1);
+                            pipeline_outstanding[pipeline].fetch_sub(1, boost::memory_order_relaxed);
+                            
+                            // The pipeline has room for a segment of the backlog again
+                            if(d_steal_depth > 0){
+                                backlog_lock.lock();
+                                feed_pipelines();
+                                backlog_lock.unlock();
+                            }
                             
                             delete temp;
                             break;
@@ -317,13 +426,19 @@ namespace gr {
                         case '3': // Got a kill message
                         {
                             if(VERBOSE)
-                                myfile << "Got a kill message \n" << std::flush;
+                                myfile << "Got a kill message from pipeline " << pipeline << "\n" << std::flush;
+                            
+                            delete temp;
                             
-                            packet_size = 1;
+                            // The other pipelines may still have results to send
+                            finished[pipeline] = true;
+                            if(++pipelines_finished < number_of_pipelines)
+                                break;
                             
-                            sent = 0;
-                            while(sent < packet_size)
-                                sent += connector->send(-1, (char*)&((temp->data())[sent]), (packet_size-sent));
+                            // Tell the parent that we're done (type-4 message)
+                            // Every result popped before the last kill message has been sent already, so this is the end-of-stream ACK
+                            char done_msg = '4';
+                            connector->send_frame(-1, &done_msg, 1, checksum);
                             
                             d_finished = true;
                             return;
@@ -344,6 +459,54 @@ namespace gr {
      	    }
         }
         
+        /*!
+         *  The negotiate() function receives the wire codecs proposed by the parent (a type-5 message), and replies with the codecs this child accepts.
+         */
+        
+        void child_impl::negotiate(){
+            
+            std::vector<char> hello_bytes;
+            float hello[6] = {0, 0, 0, 0, 0, 1};
+            
+            // Older parents propose the steal depth only with work stealing, and no result word size
+            bool steal_proposed = false;
+            if(connector->receive_frame(-1, hello_bytes, false) == 1 && hello_bytes.size() >= 4 * sizeof(float) && hello_bytes.size() <= sizeof(hello) && hello_bytes.size() % sizeof(float) == 0){
+                steal_proposed = (hello_bytes.size() >= 5 * sizeof(float));
+                floats_from_wire(&hello_bytes[0], hello, hello_bytes.size() / sizeof(float));
+            }
+            
+            sample_codec = CODEC_NONE;
+            result_codec = CODEC_NONE;
+            checksum = false;
+            result_word_size = 1;
+            
+            if((int)hello[0] == 5){
+                if(sample_codec_supported((int)hello[1]))
+                    sample_codec = (int)hello[1];
+                if(result_codec_supported((int)hello[2]))
+                    result_codec = (int)hello[2];
+                checksum = (hello[3] != 0);
+                d_steal_depth = std::max(0, (int)hello[4]);
+                if((int)hello[5] == 2 || (int)hello[5] == 4)
+                    result_word_size = (int)hello[5];
+            }
+            else{
+                std::cout << "ERROR: Expected a codec proposal from the parent" << std::endl;
+            }
+            
+            char reply[17];
+            reply[0] = '5';
+            put_float(&reply[1], (float)sample_codec);
+            put_float(&reply[5], (float)result_codec);
+            put_float(&reply[9], checksum ? 1 : 0);
+            put_float(&reply[13], (float)d_steal_depth);
+            
+            connector->send_frame(-1, reply, steal_proposed ? 17 : 13, false);
+            
+            if(VERBOSE)
+                myfile << "Accepted sample codec " << sample_codec << ", result codec " << result_codec << " and checksum " << checksum << "\n" << std::flush;
+        }
+        
         /*!
          *  This is an incomplete thread function. It is meant to be used by the child router to receive from it's children. (for multiple levels of routers)
          *
@@ -384,37 +547,173 @@ namespace gr {
             return index;
         }
         
+        /*!
+         *  The min_pipeline() function returns the index of the local pipeline with the fewest outstanding segments.
+         *  Ties go to the pipeline after the one picked last, so idle pipelines take turns.
+         *
+         *  @return index The index of the least loaded pipeline.
+         */
+        
+        int child_impl::min_pipeline(){
+            int index = -1;
+            int min = 0;
+            for(int k = 1; k <= number_of_pipelines; k++){
+                int i = (last_pipeline + k) % number_of_pipelines;
+                int outstanding = pipeline_outstanding[i].load(boost::memory_order_relaxed);
+                if(index < 0 || outstanding < min){
+                    min = outstanding;
+                    index = i;
+                }
+            }
+            
+            last_pipeline = index;
+            return index;
+        }
+        
+        /*!
+         *  The push_pipeline() function pushes a segment into the input queue of a pipeline, and counts it as outstanding there.
+         *
+         *  @param pipeline The index of the pipeline.
+         *  @param segment The segment; a kill message is not counted.
+         */
+        
+        void child_impl::push_pipeline(int pipeline, std::vector<float> *segment){
+            
+            // Counted first; the flow graph may be done with the segment as soon as it is pushed
+            if(segment_traits<float>::is_data(*segment))
+                pipeline_outstanding[pipeline].fetch_add(1, boost::memory_order_relaxed);
+            
+            // Keep attempting to push the segment until successful (may want to make this more efficient)
+            while(!in_queues[pipeline]->push(segment))
+                ;
+        }
+        
+        /*!
+         *  The feed_pipelines() function moves segments from the front of the backlog into the pipelines, as long as one of them has
+         *  fewer than steal_depth segments outstanding. Once the backlog is empty behind the end of the stream, every pipeline gets a
+         *  kill message. Called with backlog_lock held.
+         */
+        
+        void child_impl::feed_pipelines(){
+            
+            while(!backlog.empty()){
+                int pipeline = min_pipeline();
+                
+                if(d_steal_depth > 0 && pipeline_outstanding[pipeline].load(boost::memory_order_relaxed) >= d_steal_depth)
+                    break; // Every pipeline is busy; the rest can still be stolen
+                
+                push_pipeline(pipeline, backlog.front());
+                backlog.pop_front();
+            }
+            
+            if(backlog.empty() && kill_received && !kill_forwarded){
+                for(int i = 0; i < number_of_pipelines; i++){
+                    std::vector<float> *kill = new std::vector<float>();
+                    segment_traits<float>::write_kill(*kill);
+                    push_pipeline(i, kill);
+                }
+                kill_forwarded = true;
+            }
+        }
+        
+        /*!
+         *  The give_back() function answers a steal request of the parent: up to count segments are taken from the back of the backlog
+         *  (the ones this child would have started last) and sent back in one type-6 message, in the order they were received.
+         *
+         *  @param count The most segments to give back.
+         */
+        
+        void child_impl::give_back(int count){
+            
+            std::vector< std::vector<float>* > taken;
+            
+            backlog_lock.lock();
+            while((int)taken.size() < count && !backlog.empty()){
+                taken.insert(taken.begin(), backlog.back());
+                backlog.pop_back();
+            }
+            backlog_lock.unlock();
+            
+            std::vector<char> message(5);
+            message[0] = '6';
+            put_int32(&message[1], (int32_t)taken.size());
+            
+            for(size_t i = 0; i < taken.size(); i++){
+                std::vector<float> &segment = *taken[i];
+                int data_size = (int)segment_traits<float>::size(segment);
+                
+                size_t table_size;
+                const char *table = segment_tag_table(segment, table_size);
+                
+                // Size, then the three float header and the samples in wire order, then the tag table (already in wire order)
+                size_t at = message.size();
+                int size = (3 + data_size) * sizeof(float) + table_size;
+                message.resize(at + 4 + size);
+                
+                put_int32(&message[at], size);
+                floats_to_wire(&segment[0], &message[at + 4], 3 + data_size);
+                if(table_size > 0)
+                    memcpy(&message[at + 4 + (3 + data_size) * sizeof(float)], table, table_size);
+                
+                // No longer outstanding here
+                decrement(1);
+                delete taken[i];
+            }
+            
+            connector->send_frame(-1, &message[0], message.size(), checksum);
+            
+            if(VERBOSE)
+                myfile << "Gave " << taken.size() << " segments back to the parent\n" << std::flush;
+        }
+        
+        /*!
+         *  The pop_result() function pops the next result from the output queues, trying every pipeline that has not finished in turn.
+         *
+         *  @param result The popped result.
+         *  @param pipeline The index of the pipeline it came from.
+         *  @param finished The pipelines whose kill message has been popped already; their queues are not read anymore.
+         *  @return bool True if a result was popped.
+         */
+        
+        bool child_impl::pop_result(std::vector<char>* &result, int &pipeline, const std::vector<bool> &finished){
+            for(int k = 0; k < number_of_pipelines; k++){
+                int i = (next_result + k) % number_of_pipelines;
+                if(!finished[i] && out_queues[i]->pop(result)){
+                    pipeline = i;
+                    next_result = (i + 1) % number_of_pipelines;
+                    return true;
+                }
+            }
+            return false;
+        }
+        
         /*!
          *  The get_weight() function returns the child router's current weight.
          *
-         *  @return global_counter The weight of the child router.
+         *  @return weight The outstanding segments (queued in a pipeline or held back), the same unit the root counts up as it assigns segments.
          */
         
-        inline int child_impl::get_weight(){
+        inline float child_impl::get_weight(){
             
-            //For simple application with no sub-trees, simply return outstandng windows
-            return global_counter;
+            //For simple application with no sub-trees, simply return outstanding segments
+            return (float)global_counter.load(boost::memory_order_relaxed);
         }
         
         
         /*!
-         *  The decrement() function is a thread-safe method that decreases the weight of the child router by one.
+         *  The decrement() function is a lock-free method that decreases the weight of the child router by a number of segments.
          */
         
-        inline void child_impl::decrement(){
-            global_lock.lock();
-            global_counter--;
-            global_lock.unlock();
+        inline void child_impl::decrement(int segments){
+            global_counter.fetch_sub(segments, boost::memory_order_relaxed);
         }
         
         /*!
-         *  The decrement() function is a thread-safe method that increases the weight of the child router by one.
+         *  The increment() function is a lock-free method that increases the weight of the child router by a number of segments.
          */
         
-        inline  void child_impl::increment(){
-            global_lock.lock();
-            global_counter++;
-            global_lock.unlock();
+        inline void child_impl::increment(int segments){
+            global_counter.fetch_add(segments, boost::memory_order_relaxed);
         }
     } /* namespace router */
 } /* namespace gr */
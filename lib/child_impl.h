@@ -22,11 +22,14 @@
 #define INCLUDED_ROUTER_CHILD_IMPL_H
 
 #include "NetworkInterface.h"
+#include "codec.h"
 #include <router/child.h>
 #include <memory>
 #include <boost/lockfree/queue.hpp>
 #include <boost/thread.hpp>
+#include <boost/atomic.hpp>
 #include <vector>
+#include <deque>
 #include <fstream>
 
 namespace gr {
@@ -52,18 +55,38 @@ namespace gr {
             int child_index;
             
             int number_of_children;
-            bool d_finished;
+            boost::atomic<bool> d_finished; // Polled by the send and receive threads while another thread sets it
             char * parent_hostname;
             
-            // Queues used to read from and write to
-            boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > *in_queue;
+            // Queues used to read from and write to; one pair per local pipeline
+            std::vector< boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> >* > in_queues;
             float in_queue_counter;
             
-            boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > *out_queue;
+            std::vector< boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> >* > out_queues;
             float out_queue_counter;
             
-            int global_counter;
-            boost::mutex global_lock;
+            int number_of_pipelines;
+            
+            // Segments pushed into each pipeline whose results have not been sent back yet
+            boost::atomic<int> *pipeline_outstanding;
+            
+            // Pipeline the last segment was pushed into; ties between idle pipelines go to the ones after it
+            int last_pipeline;
+            
+            // Work stealing: at most steal_depth segments per pipeline are queued for the flow graphs, the rest wait in the
+            // backlog, where the parent can take them back (0 without stealing)
+            int d_steal_depth;
+            std::deque< std::vector<float>* > backlog;
+            boost::mutex backlog_lock;
+            bool kill_received; // The end of the stream is behind the backlog
+            bool kill_forwarded; // The pipelines have been given their kill messages
+            boost::atomic<int> steal_request; // Segments the parent asked back; -1 for none
+            
+            // Pipeline the next result is looked for first, so that every pipeline gets its turn
+            int next_result;
+            
+            // Segments received from the parent that are still here (queued in a pipeline or held back); reported as the weight
+            boost::atomic<int> global_counter;
             
             boost::mutex file_lock;
             
@@ -77,10 +100,22 @@ namespace gr {
             // Connector used for networking between nodes
             NetworkInterface *connector;
             
+            // Codecs accepted from the parent for samples and results
+            int sample_codec;
+            int result_codec;
+            int result_word_size; // Bytes per word of the result data, as proposed by the parent
+            
+            // CRC32C trailers agreed with the parent
+            bool checksum;
+            
             // Thread programs
             void receive_root(); // Receive messages from root
             void send_root(); // Send messages to root
             
+            // Accept the wire codecs proposed by the parent
+            void negotiate();
+
+            
             // This is not implemented yet
             void receive_child(int index);
             void send_child(int index);
@@ -88,15 +123,30 @@ namespace gr {
             // Determine index of min child
             int min();
             
+            // Pipeline with the fewest outstanding segments
+            int min_pipeline();
+            
+            // Push a segment into a pipeline
+            void push_pipeline(int pipeline, std::vector<float> *segment);
+            
+            // Move segments from the backlog into the pipelines that have room (backlog_lock held)
+            void feed_pipelines();
+            
+            // Give up to count segments of the backlog back to the parent (a type-6 message)
+            void give_back(int count);
+            
+            // Pop a result from any pipeline that has not finished yet
+            bool pop_result(std::vector<char>* &result, int &pipeline, const std::vector<bool> &finished);
+            
             // Global counter increment/decrement functions
-            void increment();
-            void decrement();
+            void increment(int segments);
+            void decrement(int segments);
             
             // Return global counter value
-            int get_weight();
+            float get_weight();
             
         public:
-            child_impl(int number_of_children, int child_index, char* hostname, boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > &in_queue, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &out_queue, double throughput);
+            child_impl(int number_of_children, int child_index, char* hostname, const std::vector< boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> >* > &in_queues, const std::vector< boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> >* > &out_queues, double throughput, const connection_options &options);
             ~child_impl();
             
             // Where all the action really happens
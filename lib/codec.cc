@@ -0,0 +1,318 @@
+/* -*- c++ -*- */
+/*
+ *  Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ Sample codecs (root -> child)
+ |
+ CODEC_SC16: float < scale > followed by int16 < sample / scale > for every sample
+ CODEC_SC8: float < scale > followed by int8 < sample / scale > for every sample
+ |
+ The scale is chosen per segment so that the largest magnitude sample maps to full scale.
+ The scale and the int16 samples are little-endian, like the rest of the wire format (wire_format.h).
+
+ Result codec (child -> root)
+ |
+ CODEC_LZ: a byte oriented LZ77 format in the style of LZ4. The data is a list of sequences:
+ byte < token > -- high nibble: number of literals, low nibble: match length - 4 (15 = more bytes follow)
+ byte < literal length > -- only if the high nibble is 15; a run of 255s ends with a byte < 255
+ byte < literals >
+ byte * 2 < offset > -- little-endian distance back to the match (not present in the last sequence)
+ byte < match length > -- only if the low nibble is 15; same encoding as the literal length
+ |
+ */
+
+#include "codec.h"
+#include "kernels.h"
+#include "wire_format.h"
+#include <string.h>
+#include <stdint.h>
+
+namespace gr {
+    namespace router {
+        
+        static const int LZ_MIN_MATCH = 4;
+        static const int LZ_HASH_BITS = 12;
+        static const int LZ_MAX_OFFSET = 65535;
+        static const int LZ_LAST_LITERALS = 5; // The last bytes are always sent as literals
+        
+        /*!
+         *  Returns True if the codec can be used for the samples sent from root to child.
+         */
+        
+        bool sample_codec_supported(int codec){
+            return (codec == CODEC_NONE) || (codec == CODEC_SC16) || (codec == CODEC_SC8);
+        }
+        
+        /*!
+         *  Returns True if the codec can be used for the results sent from child to root.
+         */
+        
+        bool result_codec_supported(int codec){
+            return (codec == CODEC_NONE) || (codec == CODEC_LZ);
+        }
+        
+        /*!
+         *  Returns the number of bytes that a segment of floats takes on the wire.
+         *
+         *  @param codec The sample codec.
+         *  @param num_samples The number of float samples in the segment.
+         *  @return The size in bytes of the encoded samples.
+         */
+        
+        int encoded_samples_size(int codec, int num_samples){
+            switch(codec){
+                case CODEC_SC16:
+                    return sizeof(float) + num_samples * sizeof(int16_t);
+                case CODEC_SC8:
+                    return sizeof(float) + num_samples * sizeof(int8_t);
+                default:
+                    return num_samples * sizeof(float);
+            }
+        }
+        
+        /*!
+         *  Encodes a segment of floats with a sample codec.
+         *
+         *  @param codec The sample codec.
+         *  @param in Pointer to the float samples.
+         *  @param num_samples The number of samples.
+         *  @param &out The vector the encoded bytes are appended to.
+         */
+        
+        void encode_samples(int codec, const float *in, int num_samples, std::vector<char> &out){
+            
+            size_t start = out.size();
+            out.resize(start + encoded_samples_size(codec, num_samples));
+            char *o = &out[start];
+            
+            if(codec != CODEC_SC16 && codec != CODEC_SC8){
+                floats_to_wire(in, o, num_samples);
+                return;
+            }
+            
+            float full_scale = (codec == CODEC_SC16) ? 32767.0f : 127.0f;
+            float max = max_magnitude(in, num_samples);
+            float scale = (max > 0) ? (max / full_scale) : 1.0f;
+            float inverse = 1.0f / scale;
+            
+            put_float(o, scale);
+            o += sizeof(float);
+            
+            if(codec == CODEC_SC16){
+                float_to_int16(in, o, inverse, num_samples);
+                int16s_wire_order(o, num_samples);
+            }
+            else
+                float_to_int8(in, o, inverse, num_samples);
+        }
+        
+        /*!
+         *  Decodes a segment of floats encoded with a sample codec.
+         *
+         *  @param codec The sample codec.
+         *  @param in Pointer to the encoded bytes.
+         *  @param num_samples The number of samples.
+         *  @param out Pointer to where the float samples are written.
+         */
+        
+        void decode_samples(int codec, const char *in, int num_samples, float *out){
+            
+            if(codec != CODEC_SC16 && codec != CODEC_SC8){
+                floats_from_wire(in, out, num_samples);
+                return;
+            }
+            
+            float scale = get_float(in);
+            in += sizeof(float);
+            
+            if(codec == CODEC_SC16 && ROUTER_WIRE_SWAP && num_samples > 0){
+                std::vector<char> native(in, in + num_samples * sizeof(int16_t)); // Swap a copy; the input is const
+                int16s_wire_order(&native[0], num_samples);
+                int16_to_float(&native[0], out, scale, num_samples);
+            }
+            else if(codec == CODEC_SC16)
+                int16_to_float(in, out, scale, num_samples);
+            else
+                int8_to_float(in, out, scale, num_samples);
+        }
+        
+        static inline uint32_t read32(const unsigned char *p){
+            uint32_t value;
+            memcpy(&value, p, sizeof(value));
+            return value;
+        }
+        
+        static inline uint32_t lz_hash(uint32_t sequence){
+            return (sequence * 2654435761U) >> (32 - LZ_HASH_BITS);
+        }
+        
+        /// Append a length that did not fit in a token nibble
+        static void lz_write_length(std::vector<char> &out, int length){
+            while(length >= 255){
+                out.push_back((char)255);
+                length -= 255;
+            }
+            out.push_back((char)length);
+        }
+        
+        /// Append one sequence: literals followed by a match (match_length = 0 for the last sequence)
+        static void lz_write_sequence(std::vector<char> &out, const unsigned char *literals, int literal_length, int offset, int match_length){
+            
+            int match_code = (match_length > 0) ? (match_length - LZ_MIN_MATCH) : 0;
+            unsigned char token = ((literal_length < 15 ? literal_length : 15) << 4) | (match_code < 15 ? match_code : 15);
+            out.push_back((char)token);
+            
+            if(literal_length >= 15)
+                lz_write_length(out, literal_length - 15);
+            out.insert(out.end(), (const char *)literals, (const char *)literals + literal_length);
+            
+            if(match_length == 0)
+                return;
+            
+            out.push_back((char)(offset & 0xff));
+            out.push_back((char)(offset >> 8));
+            
+            if(match_code >= 15)
+                lz_write_length(out, match_code - 15);
+        }
+        
+        /*!
+         *  Compresses a byte buffer. The compression is lossless and fast rather than strong.
+         *
+         *  @param in Pointer to the bytes to compress.
+         *  @param size The number of bytes.
+         *  @param &out The vector the compressed bytes are appended to.
+         */
+        
+        void lz_compress(const char *in, int size, std::vector<char> &out){
+            
+            const unsigned char *src = (const unsigned char *)in;
+            int table[1 << LZ_HASH_BITS];
+            for(int i = 0; i < (1 << LZ_HASH_BITS); i++)
+                table[i] = -1;
+            
+            int anchor = 0; // Start of the literals not yet written
+            int ip = 0;
+            int limit = size - LZ_LAST_LITERALS - LZ_MIN_MATCH;
+            
+            while(ip < limit){
+                
+                uint32_t sequence = read32(&src[ip]);
+                uint32_t h = lz_hash(sequence);
+                int ref = table[h];
+                table[h] = ip;
+                
+                if(ref < 0 || (ip - ref) > LZ_MAX_OFFSET || read32(&src[ref]) != sequence){
+                    ip++;
+                    continue;
+                }
+                
+                // Extend the match as far as it goes
+                int match_length = LZ_MIN_MATCH;
+                while((ip + match_length) < (size - LZ_LAST_LITERALS) && src[ref + match_length] == src[ip + match_length])
+                    match_length++;
+                
+                lz_write_sequence(out, &src[anchor], ip - anchor, ip - ref, match_length);
+                
+                ip += match_length;
+                anchor = ip;
+            }
+            
+            // Whatever is left goes out as literals
+            lz_write_sequence(out, &src[anchor], size - anchor, 0, 0);
+        }
+        
+        /// Read a length that did not fit in a token nibble; False if we run off the end of the input
+        static bool lz_read_length(const unsigned char *&ip, const unsigned char *end, int &length){
+            unsigned char byte;
+            do{
+                if(ip >= end)
+                    return false;
+                byte = *ip++;
+                length += byte;
+            } while(byte == 255);
+            return true;
+        }
+        
+        /*!
+         *  Decompresses a buffer compressed with lz_compress().
+         *
+         *  @param in Pointer to the compressed bytes.
+         *  @param compressed_size The number of compressed bytes.
+         *  @param out Pointer to where the decompressed bytes are written.
+         *  @param size The expected number of decompressed bytes.
+         *  @return True if exactly size bytes were decompressed; False if the compressed data is malformed.
+         */
+        
+        bool lz_decompress(const char *in, int compressed_size, char *out, int size){
+            
+            const unsigned char *ip = (const unsigned char *)in;
+            const unsigned char *end = ip + compressed_size;
+            unsigned char *op = (unsigned char *)out;
+            unsigned char *out_end = op + size;
+            
+            while(ip < end){
+                
+                unsigned char token = *ip++;
+                
+                int literal_length = token >> 4;
+                if(literal_length == 15 && !lz_read_length(ip, end, literal_length))
+                    return false;
+                
+                if((end - ip) < literal_length || (out_end - op) < literal_length)
+                    return false;
+                
+                memcpy(op, ip, literal_length);
+                ip += literal_length;
+                op += literal_length;
+                
+                // The last sequence has no match
+                if(ip == end)
+                    break;
+                
+                if((end - ip) < 2)
+                    return false;
+                
+                int offset = ip[0] | (ip[1] << 8);
+                ip += 2;
+                
+                if(offset == 0 || offset > (op - (unsigned char *)out))
+                    return false;
+                
+                int match_length = token & 15;
+                if(match_length == 15 && !lz_read_length(ip, end, match_length))
+                    return false;
+                match_length += LZ_MIN_MATCH;
+                
+                if((out_end - op) < match_length)
+                    return false;
+                
+                // Byte by byte; the match may overlap the bytes being written
+                const unsigned char *match = op - offset;
+                for(int i = 0; i < match_length; i++)
+                    op[i] = match[i];
+                op += match_length;
+            }
+            
+            return op == out_end;
+        }
+        
+    } /* namespace router */
+} /* namespace gr */
@@ -0,0 +1,52 @@
+/* -*- c++ -*- */
+/*
+ *  Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_ROUTER_CODEC_H
+#define INCLUDED_ROUTER_CODEC_H
+
+#include <router/wire_codec.h>
+#include <vector>
+
+namespace gr {
+    namespace router {
+        
+        // Is this codec supported for samples (SC16/SC8) or results (LZ)?
+        bool sample_codec_supported(int codec);
+        bool result_codec_supported(int codec);
+        
+        // Number of bytes that num_samples floats take on the wire with the given sample codec
+        int encoded_samples_size(int codec, int num_samples);
+        
+        // Append num_samples floats, encoded with the given sample codec, to out
+        void encode_samples(int codec, const float *in, int num_samples, std::vector<char> &out);
+        
+        // Decode num_samples floats from in (encoded_samples_size(codec, num_samples) bytes)
+        void decode_samples(int codec, const char *in, int num_samples, float *out);
+        
+        // Lossless LZ compression of a byte buffer; the compressed bytes are appended to out
+        void lz_compress(const char *in, int size, std::vector<char> &out);
+        
+        // Decompress exactly size bytes into out; False if the compressed data is malformed
+        bool lz_decompress(const char *in, int compressed_size, char *out, int size);
+        
+    } // namespace router
+} // namespace gr
+
+#endif /* INCLUDED_ROUTER_CODEC_H */
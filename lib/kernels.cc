@@ -0,0 +1,602 @@
+/* -*- c++ -*- */
+/*
+ *  Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "kernels.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define ROUTER_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__GNUC__) && defined(__linux__)
+#define ROUTER_KERNELS_ARM64
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+
+namespace gr {
+    namespace router {
+        
+        enum { ARCH_GENERIC = 0, ARCH_SSE2 = 1, ARCH_AVX2 = 2, ARCH_AVX512 = 3 };
+        
+        static const char *arch_names[] = {"generic", "sse2", "avx2", "avx512"};
+        
+        /// Find the best instruction set supported by the CPU; GR_ROUTER_SIMD can lower it (e.g. for benchmarking)
+        static int detect_arch(){
+            
+            int arch = ARCH_GENERIC;
+            
+#ifdef ROUTER_KERNELS_X86
+            __builtin_cpu_init();
+            if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+                arch = ARCH_AVX512;
+            else if(__builtin_cpu_supports("avx2"))
+                arch = ARCH_AVX2;
+            else if(__builtin_cpu_supports("sse2"))
+                arch = ARCH_SSE2;
+#endif
+            
+            const char *requested = getenv("GR_ROUTER_SIMD");
+            if(requested != NULL){
+                for(int i = ARCH_GENERIC; i < arch; i++){
+                    if(strcmp(requested, arch_names[i]) == 0)
+                        return i;
+                }
+            }
+            
+            return arch;
+        }
+        
+        static int arch(){
+            static int detected = detect_arch();
+            return detected;
+        }
+        
+        const char* kernel_arch(){
+            return arch_names[arch()];
+        }
+        
+        //----------
+        // Generic kernels
+        //----------
+        
+        float max_magnitude_generic(const float *in, int n){
+            float max = 0;
+            for(int i = 0; i < n; i++){
+                float magnitude = fabsf(in[i]);
+                if(magnitude > max)
+                    max = magnitude;
+            }
+            return max;
+        }
+        
+        static inline long saturate(float value, float low, float high){
+            if(value > high)
+                value = high;
+            if(value < low)
+                value = low;
+            return lrintf(value);
+        }
+        
+        void float_to_int16_generic(const float *in, void *out, float gain, int n){
+            char *o = (char *)out;
+            for(int i = 0; i < n; i++){
+                int16_t value = (int16_t)saturate(in[i] * gain, -32768.0f, 32767.0f);
+                memcpy(&o[i * sizeof(int16_t)], &value, sizeof(int16_t));
+            }
+        }
+        
+        void float_to_int8_generic(const float *in, void *out, float gain, int n){
+            int8_t *o = (int8_t *)out;
+            for(int i = 0; i < n; i++)
+                o[i] = (int8_t)saturate(in[i] * gain, -128.0f, 127.0f);
+        }
+        
+        void int16_to_float_generic(const void *in, float *out, float scale, int n){
+            const char *p = (const char *)in;
+            for(int i = 0; i < n; i++){
+                int16_t value;
+                memcpy(&value, &p[i * sizeof(int16_t)], sizeof(int16_t));
+                out[i] = value * scale;
+            }
+        }
+        
+        void int8_to_float_generic(const void *in, float *out, float scale, int n){
+            const int8_t *p = (const int8_t *)in;
+            for(int i = 0; i < n; i++)
+                out[i] = p[i] * scale;
+        }
+        
+        void byteswap16_generic(const void *in, void *out, int n){
+            const unsigned char *p = (const unsigned char *)in;
+            unsigned char *o = (unsigned char *)out;
+            for(int i = 0; i < n; i++){
+                unsigned char b0 = p[2*i], b1 = p[2*i + 1];
+                o[2*i] = b1;
+                o[2*i + 1] = b0;
+            }
+        }
+        
+        void byteswap32_generic(const void *in, void *out, int n){
+            const unsigned char *p = (const unsigned char *)in;
+            unsigned char *o = (unsigned char *)out;
+            for(int i = 0; i < n; i++){
+                unsigned char b0 = p[4*i], b1 = p[4*i + 1], b2 = p[4*i + 2], b3 = p[4*i + 3];
+                o[4*i] = b3;
+                o[4*i + 1] = b2;
+                o[4*i + 2] = b1;
+                o[4*i + 3] = b0;
+            }
+        }
+        
+        /// Byte-wise CRC32C lookup table (reflected polynomial 0x82F63B78)
+        struct crc32c_lookup{
+            uint32_t entry[256];
+            
+            crc32c_lookup(){
+                for(uint32_t i = 0; i < 256; i++){
+                    uint32_t crc = i;
+                    for(int bit = 0; bit < 8; bit++)
+                        crc = (crc & 1) ? ((crc >> 1) ^ 0x82F63B78U) : (crc >> 1);
+                    entry[i] = crc;
+                }
+            }
+        };
+        
+        static const uint32_t* crc32c_table(){
+            static const crc32c_lookup table; // Built once, on first use; the first receivers may get here at the same time
+            return table.entry;
+        }
+        
+        uint32_t crc32c_generic(uint32_t crc, const void *data, size_t size){
+            const uint32_t *table = crc32c_table();
+            const unsigned char *p = (const unsigned char *)data;
+            crc = ~crc;
+            for(size_t i = 0; i < size; i++)
+                crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+            return ~crc;
+        }
+        
+#ifdef ROUTER_KERNELS_X86
+        
+        //----------
+        // SSE2 kernels
+        //----------
+        
+        __attribute__((target("sse2")))
+        static float max_magnitude_sse2(const float *in, int n){
+            __m128 sign = _mm_set1_ps(-0.0f);
+            __m128 max = _mm_setzero_ps();
+            int i = 0;
+            for(; i + 4 <= n; i += 4)
+                max = _mm_max_ps(max, _mm_andnot_ps(sign, _mm_loadu_ps(&in[i])));
+            
+            float lanes[4];
+            _mm_storeu_ps(lanes, max);
+            float result = max_magnitude_generic(&in[i], n - i);
+            for(int j = 0; j < 4; j++)
+                result = (lanes[j] > result) ? lanes[j] : result;
+            return result;
+        }
+        
+        __attribute__((target("sse2")))
+        static void float_to_int16_sse2(const float *in, void *out, float gain, int n){
+            char *o = (char *)out;
+            __m128 g = _mm_set1_ps(gain), low = _mm_set1_ps(-32768.0f), high = _mm_set1_ps(32767.0f);
+            int i = 0;
+            for(; i + 8 <= n; i += 8){
+                __m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(&in[i]), g), low), high);
+                __m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(&in[i + 4]), g), low), high);
+                _mm_storeu_si128((__m128i *)&o[i * 2], _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+            }
+            float_to_int16_generic(&in[i], &o[i * 2], gain, n - i);
+        }
+        
+        __attribute__((target("sse2")))
+        static void float_to_int8_sse2(const float *in, void *out, float gain, int n){
+            char *o = (char *)out;
+            __m128 g = _mm_set1_ps(gain), low = _mm_set1_ps(-128.0f), high = _mm_set1_ps(127.0f);
+            int i = 0;
+            for(; i + 16 <= n; i += 16){
+                __m128i v[4];
+                for(int j = 0; j < 4; j++)
+                    v[j] = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(&in[i + 4*j]), g), low), high));
+                __m128i words = _mm_packs_epi32(v[0], v[1]);
+                __m128i words2 = _mm_packs_epi32(v[2], v[3]);
+                _mm_storeu_si128((__m128i *)&o[i], _mm_packs_epi16(words, words2));
+            }
+            float_to_int8_generic(&in[i], &o[i], gain, n - i);
+        }
+        
+        __attribute__((target("sse2")))
+        static void int16_to_float_sse2(const void *in, float *out, float scale, int n){
+            const char *p = (const char *)in;
+            __m128 s = _mm_set1_ps(scale);
+            int i = 0;
+            for(; i + 8 <= n; i += 8){
+                __m128i x = _mm_loadu_si128((const __m128i *)&p[i * 2]);
+                __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+                __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+                _mm_storeu_ps(&out[i], _mm_mul_ps(_mm_cvtepi32_ps(lo), s));
+                _mm_storeu_ps(&out[i + 4], _mm_mul_ps(_mm_cvtepi32_ps(hi), s));
+            }
+            int16_to_float_generic(&p[i * 2], &out[i], scale, n - i);
+        }
+        
+        __attribute__((target("sse2")))
+        static void int8_to_float_sse2(const void *in, float *out, float scale, int n){
+            const char *p = (const char *)in;
+            __m128 s = _mm_set1_ps(scale);
+            int i = 0;
+            for(; i + 8 <= n; i += 8){
+                __m128i x = _mm_loadl_epi64((const __m128i *)&p[i]);
+                __m128i words = _mm_srai_epi16(_mm_unpacklo_epi8(x, x), 8);
+                __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(words, words), 16);
+                __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(words, words), 16);
+                _mm_storeu_ps(&out[i], _mm_mul_ps(_mm_cvtepi32_ps(lo), s));
+                _mm_storeu_ps(&out[i + 4], _mm_mul_ps(_mm_cvtepi32_ps(hi), s));
+            }
+            int8_to_float_generic(&p[i], &out[i], scale, n - i);
+        }
+        
+        __attribute__((target("sse2")))
+        static void byteswap16_sse2(const void *in, void *out, int n){
+            const char *p = (const char *)in;
+            char *o = (char *)out;
+            int i = 0;
+            for(; i + 8 <= n; i += 8){
+                __m128i x = _mm_loadu_si128((const __m128i *)&p[i * 2]);
+                _mm_storeu_si128((__m128i *)&o[i * 2], _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8)));
+            }
+            byteswap16_generic(&p[i * 2], &o[i * 2], n - i);
+        }
+        
+        __attribute__((target("sse2")))
+        static void byteswap32_sse2(const void *in, void *out, int n){
+            const char *p = (const char *)in;
+            char *o = (char *)out;
+            int i = 0;
+            for(; i + 4 <= n; i += 4){
+                __m128i x = _mm_loadu_si128((const __m128i *)&p[i * 4]);
+                x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8)); // swap bytes within each half
+                x = _mm_shufflelo_epi16(_mm_shufflehi_epi16(x, 0xB1), 0xB1); // swap the halves
+                _mm_storeu_si128((__m128i *)&o[i * 4], x);
+            }
+            byteswap32_generic(&p[i * 4], &o[i * 4], n - i);
+        }
+        
+        //----------
+        // AVX2 kernels
+        //----------
+        
+        __attribute__((target("avx2")))
+        static float max_magnitude_avx2(const float *in, int n){
+            __m256 sign = _mm256_set1_ps(-0.0f);
+            __m256 max = _mm256_setzero_ps();
+            int i = 0;
+            for(; i + 8 <= n; i += 8)
+                max = _mm256_max_ps(max, _mm256_andnot_ps(sign, _mm256_loadu_ps(&in[i])));
+            
+            float lanes[8];
+            _mm256_storeu_ps(lanes, max);
+            float result = max_magnitude_generic(&in[i], n - i);
+            for(int j = 0; j < 8; j++)
+                result = (lanes[j] > result) ? lanes[j] : result;
+            return result;
+        }
+        
+        __attribute__((target("avx2")))
+        static void float_to_int16_avx2(const float *in, void *out, float gain, int n){
+            char *o = (char *)out;
+            __m256 g = _mm256_set1_ps(gain), low = _mm256_set1_ps(-32768.0f), high = _mm256_set1_ps(32767.0f);
+            int i = 0;
+            for(; i + 16 <= n; i += 16){
+                __m256 a = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(&in[i]), g), low), high);
+                __m256 b = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(&in[i + 8]), g), low), high);
+                __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b)); // packs within 128-bit lanes
+                _mm256_storeu_si256((__m256i *)&o[i * 2], _mm256_permute4x64_epi64(packed, 0xD8));
+            }
+            float_to_int16_generic(&in[i], &o[i * 2], gain, n - i);
+        }
+        
+        __attribute__((target("avx2")))
+        static void float_to_int8_avx2(const float *in, void *out, float gain, int n){
+            char *o = (char *)out;
+            __m256 g = _mm256_set1_ps(gain), low = _mm256_set1_ps(-128.0f), high = _mm256_set1_ps(127.0f);
+            __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+            int i = 0;
+            for(; i + 32 <= n; i += 32){
+                __m256i v[4];
+                for(int j = 0; j < 4; j++)
+                    v[j] = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(&in[i + 8*j]), g), low), high));
+                __m256i words = _mm256_packs_epi32(v[0], v[1]);
+                __m256i words2 = _mm256_packs_epi32(v[2], v[3]);
+                __m256i bytes = _mm256_packs_epi16(words, words2); // groups of 4 bytes are interleaved across lanes
+                _mm256_storeu_si256((__m256i *)&o[i], _mm256_permutevar8x32_epi32(bytes, order));
+            }
+            float_to_int8_generic(&in[i], &o[i], gain, n - i);
+        }
+        
+        __attribute__((target("avx2")))
+        static void int16_to_float_avx2(const void *in, float *out, float scale, int n){
+            const char *p = (const char *)in;
+            __m256 s = _mm256_set1_ps(scale);
+            int i = 0;
+            for(; i + 8 <= n; i += 8){
+                __m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)&p[i * 2]));
+                _mm256_storeu_ps(&out[i], _mm256_mul_ps(_mm256_cvtepi32_ps(x), s));
+            }
+            int16_to_float_generic(&p[i * 2], &out[i], scale, n - i);
+        }
+        
+        __attribute__((target("avx2")))
+        static void int8_to_float_avx2(const void *in, float *out, float scale, int n){
+            const char *p = (const char *)in;
+            __m256 s = _mm256_set1_ps(scale);
+            int i = 0;
+            for(; i + 8 <= n; i += 8){
+                __m256i x = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)&p[i]));
+                _mm256_storeu_ps(&out[i], _mm256_mul_ps(_mm256_cvtepi32_ps(x), s));
+            }
+            int8_to_float_generic(&p[i], &out[i], scale, n - i);
+        }
+        
+        __attribute__((target("avx2")))
+        static void byteswap16_avx2(const void *in, void *out, int n){
+            const char *p = (const char *)in;
+            char *o = (char *)out;
+            __m256i mask = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                            1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+            int i = 0;
+            for(; i + 16 <= n; i += 16){
+                __m256i x = _mm256_loadu_si256((const __m256i *)&p[i * 2]);
+                _mm256_storeu_si256((__m256i *)&o[i * 2], _mm256_shuffle_epi8(x, mask));
+            }
+            byteswap16_generic(&p[i * 2], &o[i * 2], n - i);
+        }
+        
+        __attribute__((target("avx2")))
+        static void byteswap32_avx2(const void *in, void *out, int n){
+            const char *p = (const char *)in;
+            char *o = (char *)out;
+            __m256i mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+            int i = 0;
+            for(; i + 8 <= n; i += 8){
+                __m256i x = _mm256_loadu_si256((const __m256i *)&p[i * 4]);
+                _mm256_storeu_si256((__m256i *)&o[i * 4], _mm256_shuffle_epi8(x, mask));
+            }
+            byteswap32_generic(&p[i * 4], &o[i * 4], n - i);
+        }
+        
+        //----------
+        // AVX-512 kernels (conversions only; the byte-swaps use AVX2)
+        //----------
+        
+        __attribute__((target("avx512f,avx512bw")))
+        static void float_to_int16_avx512(const float *in, void *out, float gain, int n){
+            char *o = (char *)out;
+            __m512 g = _mm512_set1_ps(gain), low = _mm512_set1_ps(-32768.0f), high = _mm512_set1_ps(32767.0f);
+            int i = 0;
+            for(; i + 16 <= n; i += 16){
+                __m512 a = _mm512_min_ps(_mm512_max_ps(_mm512_mul_ps(_mm512_loadu_ps(&in[i]), g), low), high);
+                _mm256_storeu_si256((__m256i *)&o[i * 2], _mm512_cvtsepi32_epi16(_mm512_cvtps_epi32(a)));
+            }
+            float_to_int16_generic(&in[i], &o[i * 2], gain, n - i);
+        }
+        
+        __attribute__((target("avx512f,avx512bw")))
+        static void float_to_int8_avx512(const float *in, void *out, float gain, int n){
+            char *o = (char *)out;
+            __m512 g = _mm512_set1_ps(gain), low = _mm512_set1_ps(-128.0f), high = _mm512_set1_ps(127.0f);
+            int i = 0;
+            for(; i + 16 <= n; i += 16){
+                __m512 a = _mm512_min_ps(_mm512_max_ps(_mm512_mul_ps(_mm512_loadu_ps(&in[i]), g), low), high);
+                _mm_storeu_si128((__m128i *)&o[i], _mm512_cvtsepi32_epi8(_mm512_cvtps_epi32(a)));
+            }
+            float_to_int8_generic(&in[i], &o[i], gain, n - i);
+        }
+        
+        __attribute__((target("avx512f,avx512bw")))
+        static void int16_to_float_avx512(const void *in, float *out, float scale, int n){
+            const char *p = (const char *)in;
+            __m512 s = _mm512_set1_ps(scale);
+            int i = 0;
+            for(; i + 16 <= n; i += 16){
+                __m512i x = _mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i *)&p[i * 2]));
+                _mm512_storeu_ps(&out[i], _mm512_mul_ps(_mm512_cvtepi32_ps(x), s));
+            }
+            int16_to_float_generic(&p[i * 2], &out[i], scale, n - i);
+        }
+        
+        __attribute__((target("avx512f,avx512bw")))
+        static void int8_to_float_avx512(const void *in, float *out, float scale, int n){
+            const char *p = (const char *)in;
+            __m512 s = _mm512_set1_ps(scale);
+            int i = 0;
+            for(; i + 16 <= n; i += 16){
+                __m512i x = _mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i *)&p[i]));
+                _mm512_storeu_ps(&out[i], _mm512_mul_ps(_mm512_cvtepi32_ps(x), s));
+            }
+            int8_to_float_generic(&p[i], &out[i], scale, n - i);
+        }
+        
+        //----------
+        // SSE4.2 CRC32C
+        //----------
+        
+        __attribute__((target("sse4.2")))
+        static uint32_t crc32c_sse42(uint32_t crc, const void *data, size_t size){
+            const unsigned char *p = (const unsigned char *)data;
+            crc = ~crc;
+#if defined(__x86_64__)
+            uint64_t crc64 = crc;
+            for(; size >= 8; size -= 8, p += 8){
+                uint64_t word;
+                memcpy(&word, p, sizeof(word));
+                crc64 = _mm_crc32_u64(crc64, word);
+            }
+            crc = (uint32_t)crc64;
+#endif
+            for(; size >= 4; size -= 4, p += 4){
+                uint32_t word;
+                memcpy(&word, p, sizeof(word));
+                crc = _mm_crc32_u32(crc, word);
+            }
+            for(; size > 0; size--, p++)
+                crc = _mm_crc32_u8(crc, *p);
+            return ~crc;
+        }
+        
+        static bool have_sse42(){
+            static bool supported = (arch() > ARCH_GENERIC) && __builtin_cpu_supports("sse4.2");
+            return supported;
+        }
+        
+#endif /* ROUTER_KERNELS_X86 */
+        
+#ifdef ROUTER_KERNELS_ARM64
+        
+        //----------
+        // ARMv8 CRC32C
+        //----------
+        
+        __attribute__((target("+crc")))
+        static uint32_t crc32c_armv8(uint32_t crc, const void *data, size_t size){
+            const unsigned char *p = (const unsigned char *)data;
+            crc = ~crc;
+            for(; size >= 8; size -= 8, p += 8){
+                uint64_t word;
+                memcpy(&word, p, sizeof(word));
+                crc = __crc32cd(crc, word);
+            }
+            for(; size > 0; size--, p++)
+                crc = __crc32cb(crc, *p);
+            return ~crc;
+        }
+        
+        static bool have_armv8_crc(){
+            static bool supported = (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+            return supported;
+        }
+        
+#endif /* ROUTER_KERNELS_ARM64 */
+        
+        //----------
+        // Dispatch
+        //----------
+        
+        float max_magnitude(const float *in, int n){
+#ifdef ROUTER_KERNELS_X86
+            switch(arch()){
+                case ARCH_AVX512:
+                case ARCH_AVX2: return max_magnitude_avx2(in, n);
+                case ARCH_SSE2: return max_magnitude_sse2(in, n);
+            }
+#endif
+            return max_magnitude_generic(in, n);
+        }
+        
+        void float_to_int16(const float *in, void *out, float gain, int n){
+#ifdef ROUTER_KERNELS_X86
+            switch(arch()){
+                case ARCH_AVX512: float_to_int16_avx512(in, out, gain, n); return;
+                case ARCH_AVX2: float_to_int16_avx2(in, out, gain, n); return;
+                case ARCH_SSE2: float_to_int16_sse2(in, out, gain, n); return;
+            }
+#endif
+            float_to_int16_generic(in, out, gain, n);
+        }
+        
+        void float_to_int8(const float *in, void *out, float gain, int n){
+#ifdef ROUTER_KERNELS_X86
+            switch(arch()){
+                case ARCH_AVX512: float_to_int8_avx512(in, out, gain, n); return;
+                case ARCH_AVX2: float_to_int8_avx2(in, out, gain, n); return;
+                case ARCH_SSE2: float_to_int8_sse2(in, out, gain, n); return;
+            }
+#endif
+            float_to_int8_generic(in, out, gain, n);
+        }
+        
+        void int16_to_float(const void *in, float *out, float scale, int n){
+#ifdef ROUTER_KERNELS_X86
+            switch(arch()){
+                case ARCH_AVX512: int16_to_float_avx512(in, out, scale, n); return;
+                case ARCH_AVX2: int16_to_float_avx2(in, out, scale, n); return;
+                case ARCH_SSE2: int16_to_float_sse2(in, out, scale, n); return;
+            }
+#endif
+            int16_to_float_generic(in, out, scale, n);
+        }
+        
+        void int8_to_float(const void *in, float *out, float scale, int n){
+#ifdef ROUTER_KERNELS_X86
+            switch(arch()){
+                case ARCH_AVX512: int8_to_float_avx512(in, out, scale, n); return;
+                case ARCH_AVX2: int8_to_float_avx2(in, out, scale, n); return;
+                case ARCH_SSE2: int8_to_float_sse2(in, out, scale, n); return;
+            }
+#endif
+            int8_to_float_generic(in, out, scale, n);
+        }
+        
+        void byteswap16(const void *in, void *out, int n){
+#ifdef ROUTER_KERNELS_X86
+            switch(arch()){
+                case ARCH_AVX512:
+                case ARCH_AVX2: byteswap16_avx2(in, out, n); return;
+                case ARCH_SSE2: byteswap16_sse2(in, out, n); return;
+            }
+#endif
+            byteswap16_generic(in, out, n);
+        }
+        
+        void byteswap32(const void *in, void *out, int n){
+#ifdef ROUTER_KERNELS_X86
+            switch(arch()){
+                case ARCH_AVX512:
+                case ARCH_AVX2: byteswap32_avx2(in, out, n); return;
+                case ARCH_SSE2: byteswap32_sse2(in, out, n); return;
+            }
+#endif
+            byteswap32_generic(in, out, n);
+        }
+        
+        uint32_t crc32c(uint32_t crc, const void *data, size_t size){
+#ifdef ROUTER_KERNELS_X86
+            if(have_sse42())
+                return crc32c_sse42(crc, data, size);
+#endif
+#ifdef ROUTER_KERNELS_ARM64
+            if(have_armv8_crc())
+                return crc32c_armv8(crc, data, size);
+#endif
+            return crc32c_generic(crc, data, size);
+        }
+        
+    } /* namespace router */
+} /* namespace gr */
@@ -0,0 +1,71 @@
+/* -*- c++ -*- */
+/*
+ *  Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_ROUTER_KERNELS_H
+#define INCLUDED_ROUTER_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ Conversion, byte-swap and checksum kernels for the wire path.
+
+ Every kernel has a portable _generic version and a dispatched version that picks the fastest
+ implementation the CPU supports (SSE2, AVX2 or AVX-512 on x86) the first time it is called.
+ CRC32C uses the SSE4.2 or ARMv8 CRC instructions when the CPU has them.
+ The int16/int8 buffers may be unaligned; they point straight into the packet buffers.
+ */
+
+namespace gr {
+    namespace router {
+        
+        // Name of the instruction set the dispatched kernels use ("generic", "sse2", "avx2", "avx512")
+        const char* kernel_arch();
+        
+        // Largest magnitude in the buffer
+        float max_magnitude(const float *in, int n);
+        float max_magnitude_generic(const float *in, int n);
+        
+        // out[i] = saturate(round(in[i] * gain))
+        void float_to_int16(const float *in, void *out, float gain, int n);
+        void float_to_int16_generic(const float *in, void *out, float gain, int n);
+        void float_to_int8(const float *in, void *out, float gain, int n);
+        void float_to_int8_generic(const float *in, void *out, float gain, int n);
+        
+        // out[i] = in[i] * scale
+        void int16_to_float(const void *in, float *out, float scale, int n);
+        void int16_to_float_generic(const void *in, float *out, float scale, int n);
+        void int8_to_float(const void *in, float *out, float scale, int n);
+        void int8_to_float_generic(const void *in, float *out, float scale, int n);
+        
+        // Reverse the byte order of n 16-bit / 32-bit words (in and out may be the same buffer)
+        void byteswap16(const void *in, void *out, int n);
+        void byteswap16_generic(const void *in, void *out, int n);
+        void byteswap32(const void *in, void *out, int n);
+        void byteswap32_generic(const void *in, void *out, int n);
+        
+        // CRC32C (Castagnoli) of a buffer; pass the previous value of crc to checksum data in pieces
+        uint32_t crc32c(uint32_t crc, const void *data, size_t size);
+        uint32_t crc32c_generic(uint32_t crc, const void *data, size_t size);
+        
+    } // namespace router
+} // namespace gr
+
+#endif /* INCLUDED_ROUTER_KERNELS_H */
@@ -0,0 +1,108 @@
+/* -*- c++ -*- */
+/*
+ * Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "qa_queue_overlap.h"
+#include "segment_traits.h"
+#include <router/queue_sink_typed.h>
+#include <router/queue_source_typed.h>
+#include <gnuradio/top_block.h>
+#include <gnuradio/blocks/vector_source_s.h>
+#include <gnuradio/blocks/vector_sink_s.h>
+#include <gnuradio/blocks/vector_source_b.h>
+#include <gnuradio/blocks/vector_sink_b.h>
+#include <gnuradio/blocks/vector_source_c.h>
+#include <gnuradio/blocks/vector_sink_c.h>
+
+namespace gr {
+    namespace router {
+
+        typedef boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > float_queue;
+
+        /*!
+         *  Push the samples through a queue sink into a float queue, then stream them out of a queue source with the same overlap.
+         *  The source trims the history the sink added, so the output must equal the input, with no padding in between.
+         *  T is the sample type of the queue blocks, D the one of the vector blocks (the same size).
+         */
+
+        template <class T, class D, class VSOURCE, class VSINK>
+        static void round_trip(const std::vector<D> &data, int overlap)
+        {
+            float_queue queue(64);
+
+            gr::top_block_sptr into = gr::make_top_block("qa_queue_overlap_sink");
+            typename VSOURCE::sptr source = VSOURCE::make(data);
+            typename queue_sink_typed<T>::sptr sink = queue_sink_typed<T>::make(queue, false, overlap);
+            into->connect(source, 0, sink, 0);
+            into->run(); // The sink pushes the kill message when the stream ends
+
+            gr::top_block_sptr out_of = gr::make_top_block("qa_queue_overlap_source");
+            typename queue_source_typed<T>::sptr queue_source = queue_source_typed<T>::make(queue, false, true, overlap);
+            typename VSINK::sptr result = VSINK::make();
+            out_of->connect(queue_source, 0, result, 0);
+            out_of->run(); // The source ends at the kill message
+
+            std::vector<D> streamed = result->data();
+            CPPUNIT_ASSERT_EQUAL(data.size(), streamed.size());
+            for(size_t i = 0; i < data.size(); i++)
+                CPPUNIT_ASSERT(data[i] == streamed[i]);
+        }
+
+        // An overlap of 3 shorts is 6 bytes; it is rounded up to 4 shorts, a whole number of floats
+        void qa_queue_overlap::t1_short_unaligned()
+        {
+            CPPUNIT_ASSERT_EQUAL(4, (aligned_overlap<short, float>(3)));
+
+            std::vector<short> data(3 * 1536);
+            for(size_t i = 0; i < data.size(); i++)
+                data[i] = (short)(i % 1000 + 1);
+
+            round_trip<short, short, gr::blocks::vector_source_s, gr::blocks::vector_sink_s>(data, 3);
+        }
+
+        // An overlap of 3 bytes is rounded up to 4 bytes, one float
+        void qa_queue_overlap::t2_byte_unaligned()
+        {
+            CPPUNIT_ASSERT_EQUAL(4, (aligned_overlap<signed char, float>(3)));
+
+            std::vector<unsigned char> data(3 * 3072);
+            for(size_t i = 0; i < data.size(); i++)
+                data[i] = (unsigned char)(i % 100 + 1);
+
+            round_trip<signed char, unsigned char, gr::blocks::vector_source_b, gr::blocks::vector_sink_b>(data, 3);
+        }
+
+        // Complex samples are whole floats already; the overlap is kept as it is
+        void qa_queue_overlap::t3_complex()
+        {
+            CPPUNIT_ASSERT_EQUAL(3, (aligned_overlap<gr_complex, float>(3)));
+
+            std::vector<gr_complex> data(3 * 384);
+            for(size_t i = 0; i < data.size(); i++)
+                data[i] = gr_complex(i, -(float)i);
+
+            round_trip<gr_complex, gr_complex, gr::blocks::vector_source_c, gr::blocks::vector_sink_c>(data, 3);
+        }
+
+    } /* namespace router */
+} /* namespace gr */
@@ -0,0 +1,52 @@
+/* -*- c++ -*- */
+/*
+ * Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _QA_QUEUE_OVERLAP_H_
+#define _QA_QUEUE_OVERLAP_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestCase.h>
+
+namespace gr {
+    namespace router {
+
+        /*!
+         *  Round trips of typed streams through a queue sink and a queue source with an overlap.
+         */
+
+        class qa_queue_overlap : public CppUnit::TestCase
+        {
+        public:
+            CPPUNIT_TEST_SUITE(qa_queue_overlap);
+            CPPUNIT_TEST(t1_short_unaligned);
+            CPPUNIT_TEST(t2_byte_unaligned);
+            CPPUNIT_TEST(t3_complex);
+            CPPUNIT_TEST_SUITE_END();
+
+        private:
+            void t1_short_unaligned();
+            void t2_byte_unaligned();
+            void t3_complex();
+        };
+
+    } // namespace router
+} // namespace gr
+
+#endif /* _QA_QUEUE_OVERLAP_H_ */
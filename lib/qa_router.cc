@@ -26,11 +26,13 @@
  */
 
 #include "qa_router.h"
+#include "qa_queue_overlap.h"
 
 CppUnit::TestSuite *
 qa_router::suite()
 {
   CppUnit::TestSuite *s = new CppUnit::TestSuite("router");
+  s->addTest(gr::router::qa_queue_overlap::suite());
 
   return s;
 }
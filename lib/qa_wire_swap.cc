@@ -0,0 +1,437 @@
+/* -*- c++ -*- */
+/*
+ * Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ With the swap forced on, every value on the wire must be the byte-reverse of its host image. On a big-endian
+ host that makes the wire little-endian; on a little-endian host this runs the same code path, so both kinds of
+ host test what a big-endian host would send to, and read from, a little-endian one.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "qa_wire_swap.h"
+#include "wire_format.h"
+#include "codec.h"
+#include "tag_table.h"
+#include "kernels.h"
+#include "NetworkInterface.h"
+#include <router/root.h>
+#include <router/child.h>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <math.h>
+
+#if !ROUTER_WIRE_SWAP
+#error "qa_wire_swap.cc must be built with ROUTER_WIRE_SWAP=1"
+#endif
+
+namespace gr {
+    namespace router {
+
+        /// Is the wire value at p the byte-reverse of the host image of value?
+        template <class T>
+        static bool reversed(const char *p, T value)
+        {
+            char host[sizeof(T)];
+            memcpy(host, &value, sizeof(T));
+            for(size_t i = 0; i < sizeof(T); i++){
+                if(p[i] != host[sizeof(T) - 1 - i])
+                    return false;
+            }
+            return true;
+        }
+
+        // The float header of a segment, as the root sends it and the child reads it
+        void qa_wire_swap::t1_segment_header()
+        {
+            float header[3] = { 1, 123456, 768 };
+            char wire[3 * sizeof(float)];
+            floats_to_wire(header, wire, 3);
+
+            for(int i = 0; i < 3; i++)
+                CPPUNIT_ASSERT(reversed(&wire[4 * i], header[i]));
+
+            CPPUNIT_ASSERT_EQUAL(1.0f, get_float(&wire[0]));
+            CPPUNIT_ASSERT_EQUAL(123456.0f, get_float(&wire[4]));
+            CPPUNIT_ASSERT_EQUAL(768.0f, get_float(&wire[8]));
+
+            float back[3];
+            floats_from_wire(wire, back, 3);
+            for(int i = 0; i < 3; i++)
+                CPPUNIT_ASSERT_EQUAL(header[i], back[i]);
+
+            char size[4];
+            put_int32(size, 0x01020304);
+            CPPUNIT_ASSERT(reversed(size, (int32_t)0x01020304));
+            CPPUNIT_ASSERT_EQUAL((int32_t)0x01020304, get_int32(size));
+        }
+
+        // The samples, encoded with every sample codec
+        void qa_wire_swap::t2_sample_codecs()
+        {
+            const int n = 768;
+            std::vector<float> samples(n);
+            for(int i = 0; i < n; i++)
+                samples[i] = sinf(0.01f * i) * 3.5f;
+
+            int codecs[3] = { CODEC_NONE, CODEC_SC16, CODEC_SC8 };
+            for(int c = 0; c < 3; c++){
+                std::vector<char> wire;
+                encode_samples(codecs[c], &samples[0], n, wire);
+                CPPUNIT_ASSERT_EQUAL((size_t)encoded_samples_size(codecs[c], n), wire.size());
+
+                std::vector<float> back(n);
+                decode_samples(codecs[c], &wire[0], n, &back[0]);
+
+                float tolerance = (codecs[c] == CODEC_NONE) ? 0 : 3.5f / ((codecs[c] == CODEC_SC16) ? 32767.0f : 127.0f);
+                for(int i = 0; i < n; i++)
+                    CPPUNIT_ASSERT(fabsf(back[i] - samples[i]) <= tolerance);
+
+                if(codecs[c] == CODEC_NONE){
+                    CPPUNIT_ASSERT(reversed(&wire[0], samples[0]));
+                    CPPUNIT_ASSERT(reversed(&wire[4 * (n - 1)], samples[n - 1]));
+                }
+                else{
+                    // The scale in front of the samples
+                    float scale = get_float(&wire[0]);
+                    CPPUNIT_ASSERT(reversed(&wire[0], scale));
+
+                    // Each 16-bit sample is reversed on its own; read back that way, it is the sample to within one step
+                    if(codecs[c] == CODEC_SC16){
+                        for(int i = 0; i < n; i++){
+                            char host[2] = { wire[4 + 2 * i + 1], wire[4 + 2 * i] };
+                            int16_t value;
+                            memcpy(&value, host, 2);
+                            CPPUNIT_ASSERT(fabsf(value * scale - samples[i]) <= scale);
+                        }
+                    }
+                }
+            }
+
+            // LZ works on bytes, so it is the same in either order; the compressed size in front of it is not
+            std::vector<char> result(1000);
+            for(size_t i = 0; i < result.size(); i++)
+                result[i] = (char)(i % 7);
+
+            std::vector<char> compressed(4);
+            lz_compress(&result[0], result.size(), compressed);
+            put_int32(&compressed[0], (int32_t)(compressed.size() - 4));
+
+            std::vector<char> back(result.size());
+            CPPUNIT_ASSERT(lz_decompress(&compressed[4], get_int32(&compressed[0]), &back[0], back.size()));
+            CPPUNIT_ASSERT(back == result);
+        }
+
+        // The tag table that rides behind the data field
+        void qa_wire_swap::t3_tag_table()
+        {
+            tag_table writer, reader;
+
+            std::vector<gr::tag_t> tags(2);
+            tags[0].offset = 1005;
+            tags[0].key = pmt::string_to_symbol("rx_time");
+            tags[0].value = pmt::from_long(77);
+            tags[1].offset = 1010;
+            tags[1].key = pmt::string_to_symbol("rx_freq");
+            tags[1].value = pmt::from_double(915e6);
+
+            std::vector<char> table;
+            writer.write(tags, 1000, 768, sizeof(float), 0, table);
+
+            CPPUNIT_ASSERT(reversed(&table[0], (int32_t)2)); // The key count
+
+            std::vector<gr::tag_t> back;
+            CPPUNIT_ASSERT(reader.read(&table[0], table.size(), back));
+            CPPUNIT_ASSERT_EQUAL((size_t)2, back.size());
+            CPPUNIT_ASSERT_EQUAL((uint64_t)(5 * sizeof(float)), back[0].offset);
+            CPPUNIT_ASSERT_EQUAL(std::string("rx_time"), pmt::symbol_to_string(back[0].key));
+            CPPUNIT_ASSERT_EQUAL(77L, pmt::to_long(back[0].value));
+            CPPUNIT_ASSERT_EQUAL((uint64_t)(10 * sizeof(float)), back[1].offset);
+            CPPUNIT_ASSERT_EQUAL(915e6, pmt::to_double(back[1].value));
+        }
+
+        typedef boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > sample_queue;
+        typedef boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > result_queue;
+
+        static const int LOOPBACK_CHILDREN = 2;
+        static const int LOOPBACK_SEGMENTS = 200;
+        static const int LOOPBACK_SAMPLES = 256;
+
+        /// The samples of segment index; exact in float, and different in every byte of the word
+        static float loopback_sample(int index, int i)
+        {
+            return 1000.5f * index + 0.25f * i + 3e-3f;
+        }
+
+        /// Stands in for the flow graph of a child: every segment comes back as a float result with its tag table, and the kill as the one-byte kill of a queue sink
+        static void echo_flow_graph(sample_queue *in, result_queue *out, int delay_us)
+        {
+            while(true){
+                std::vector<float> *segment;
+                if(!in->pop(segment)){
+                    boost::this_thread::sleep(boost::posix_time::microseconds(50));
+                    continue;
+                }
+
+                std::vector<char> *result = new std::vector<char>();
+
+                if(segment_traits<float>::is_kill(*segment)){
+                    segment_traits<char>::write_kill(*result);
+                }
+                else{
+                    int samples = (int)segment_traits<float>::size(*segment);
+                    segment_traits<char>::write_header(*result, segment_traits<float>::index(*segment), samples * sizeof(float));
+                    result->resize(segment_traits<char>::header_items + samples * sizeof(float));
+                    memcpy(&(*result)[segment_traits<char>::header_items], &(*segment)[segment_traits<float>::header_items], samples * sizeof(float));
+
+                    size_t table_size;
+                    const char *table = segment_tag_table(*segment, table_size);
+                    append_tag_table(*result, std::vector<char>(table, table + table_size));
+
+                    if(delay_us > 0)
+                        boost::this_thread::sleep(boost::posix_time::microseconds(delay_us));
+                }
+
+                bool kill = segment_traits<float>::is_kill(*segment);
+                delete segment;
+
+                while(!out->push(result))
+                    boost::this_thread::sleep(boost::posix_time::microseconds(10));
+
+                if(kill)
+                    return;
+            }
+        }
+
+        static void make_loopback_root(root::sptr *root_router, sample_queue *in, result_queue *out)
+        {
+            connection_options options;
+            options.reuse_address = true;
+            options.result_word_size = sizeof(float);
+
+            scheduler_options scheduling;
+            scheduling.steal_depth = 1; // Child 0 is slow, so child 1 runs out of work and takes segments back from it
+
+            *root_router = root::make(LOOPBACK_CHILDREN, *in, *out, 1e12, CODEC_NONE, CODEC_LZ, true, 1, options, scheduling);
+        }
+
+        static void make_loopback_child(child::sptr *child_router, int index, sample_queue *in, result_queue *out)
+        {
+            char hostname[] = "127.0.0.1";
+            *child_router = child::make(0, index, hostname, *in, *out, 1e12);
+        }
+
+        // A root and its children over 127.0.0.1, every value swapped on the wire: the codec negotiation, the segments
+        // with their tags to the children, the LZ compressed float results back, and the segments given back for stealing
+        void qa_wire_swap::t4_loopback()
+        {
+            sample_queue root_in(1024);
+            result_queue root_out(1024);
+
+            std::vector<sample_queue*> child_in;
+            std::vector<result_queue*> child_out;
+            for(int i = 0; i < LOOPBACK_CHILDREN; i++){
+                child_in.push_back(new sample_queue(1024));
+                child_out.push_back(new result_queue(1024));
+            }
+
+            // The root waits for its children to connect
+            root::sptr root_router;
+            boost::thread root_thread(boost::bind(make_loopback_root, &root_router, &root_in, &root_out));
+            boost::this_thread::sleep(boost::posix_time::milliseconds(200));
+
+            std::vector<child::sptr> child_routers(LOOPBACK_CHILDREN);
+            boost::thread_group child_threads;
+            for(int i = 0; i < LOOPBACK_CHILDREN; i++)
+                child_threads.create_thread(boost::bind(make_loopback_child, &child_routers[i], i, child_in[i], child_out[i]));
+
+            root_thread.join();
+            child_threads.join_all();
+
+            boost::thread_group flow_graphs;
+            for(int i = 0; i < LOOPBACK_CHILDREN; i++)
+                flow_graphs.create_thread(boost::bind(echo_flow_graph, child_in[i], child_out[i], (i == 0) ? 2000 : 0));
+
+            // Every fourth segment carries a tag on its sixth sample
+            tag_table writer;
+            for(int index = 0; index < LOOPBACK_SEGMENTS; index++){
+                std::vector<float> *segment = new std::vector<float>();
+                segment_traits<float>::write_header(*segment, index, LOOPBACK_SAMPLES);
+                for(int i = 0; i < LOOPBACK_SAMPLES; i++)
+                    segment->push_back(loopback_sample(index, i));
+
+                if(index % 4 == 0){
+                    std::vector<gr::tag_t> tags(1);
+                    tags[0].offset = (uint64_t)index * LOOPBACK_SAMPLES + 5;
+                    tags[0].key = pmt::string_to_symbol("rx_time");
+                    tags[0].value = pmt::from_long(index);
+
+                    std::vector<char> table;
+                    writer.write(tags, (uint64_t)index * LOOPBACK_SAMPLES, LOOPBACK_SAMPLES, sizeof(float), 0, table);
+                    append_tag_table(*segment, table);
+                }
+
+                while(!root_in.push(segment))
+                    boost::this_thread::sleep(boost::posix_time::microseconds(10));
+            }
+
+            // Collect the results, and send the kill message once all of them are back (no steals are made once it is on its
+            // way); then wait for the kill message to come back. Give up after 20 seconds
+            std::vector<int> seen(LOOPBACK_SEGMENTS, 0);
+            int results = 0;
+            int wrong_samples = 0;
+            int wrong_tags = 0;
+            bool ended = false;
+
+            tag_table reader;
+            for(int wait = 0; wait < 20000 && !ended; wait++){
+                if(results == LOOPBACK_SEGMENTS){
+                    std::vector<float> *kill = new std::vector<float>();
+                    segment_traits<float>::write_kill(*kill);
+                    while(!root_in.push(kill))
+                        boost::this_thread::sleep(boost::posix_time::microseconds(10));
+                    results++;
+                }
+
+                std::vector<char> *result;
+                if(!root_out.pop(result)){
+                    boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+                    continue;
+                }
+
+                if(segment_traits<char>::is_kill(*result)){
+                    ended = true;
+                    delete result;
+                    continue;
+                }
+
+                CPPUNIT_ASSERT(segment_traits<char>::is_data(*result));
+
+                int index = (int)segment_traits<char>::index(*result);
+                CPPUNIT_ASSERT(index >= 0 && index < LOOPBACK_SEGMENTS);
+                CPPUNIT_ASSERT_EQUAL((float)(LOOPBACK_SAMPLES * sizeof(float)), segment_traits<char>::size(*result));
+                seen[index]++;
+                results++;
+
+                for(int i = 0; i < LOOPBACK_SAMPLES; i++){
+                    float sample;
+                    memcpy(&sample, &(*result)[segment_traits<char>::header_items + i * sizeof(float)], sizeof(float));
+                    if(sample != loopback_sample(index, i))
+                        wrong_samples++;
+                }
+
+                size_t table_size;
+                const char *table = segment_tag_table(*result, table_size);
+                std::vector<gr::tag_t> tags;
+                CPPUNIT_ASSERT(reader.read(table, table_size, tags));
+
+                if(index % 4 == 0){
+                    if(tags.size() != 1 || tags[0].offset != 5 * sizeof(float) || pmt::symbol_to_string(tags[0].key) != "rx_time" || pmt::to_long(tags[0].value) != index)
+                        wrong_tags++;
+                }
+                else if(!tags.empty()){
+                    wrong_tags++;
+                }
+
+                delete result;
+            }
+
+            flow_graphs.join_all();
+            root_router.reset();
+            child_routers.clear();
+
+            for(int i = 0; i < LOOPBACK_CHILDREN; i++){
+                delete child_in[i];
+                delete child_out[i];
+            }
+
+            CPPUNIT_ASSERT(ended);
+            for(int index = 0; index < LOOPBACK_SEGMENTS; index++)
+                CPPUNIT_ASSERT_EQUAL(1, seen[index]);
+            CPPUNIT_ASSERT_EQUAL(0, wrong_samples);
+            CPPUNIT_ASSERT_EQUAL(0, wrong_tags);
+        }
+
+        /// Append a frame with a CRC32C trailer, as NetworkInterface::send_frame() writes it
+        static void append_frame(std::vector<char> &stream, const std::string &body)
+        {
+            char header[8];
+            memcpy(header, "GRFM", 4);
+            put_int32(&header[4], (int32_t)body.size() + 4);
+
+            char trailer[4];
+            put_int32(trailer, (int32_t)crc32c(crc32c(0, header, 8), body.data(), body.size()));
+
+            stream.insert(stream.end(), header, header + 8);
+            stream.insert(stream.end(), body.begin(), body.end());
+            stream.insert(stream.end(), trailer, trailer + 4);
+        }
+
+        // A bit flipped in the length of a frame makes it 8 bytes longer, so it swallows the header of the next frame; the
+        // receiver drops it for its checksum, and must find the next frame inside the bytes it already read
+        void qa_wire_swap::t5_corrupt_length()
+        {
+            connection_options options;
+            options.reuse_address = true;
+
+            NetworkInterface parent(sizeof(char), 1, 8080, true, options);
+            NetworkInterface child(sizeof(char), 0, 8080, false, options);
+
+            char hostname[] = "127.0.0.1";
+            boost::thread child_thread(boost::bind(&NetworkInterface::connect, &child, hostname));
+            boost::this_thread::sleep(boost::posix_time::milliseconds(200));
+            parent.connect(NULL);
+            child_thread.join();
+
+            std::vector<char> stream;
+            append_frame(stream, std::string(32, 'x'));
+            put_int32(&stream[4], get_int32(&stream[4]) ^ 8); // 36 bytes become 44
+
+            const char *bodies[] = {"one", "two", "three", "end"};
+            for(int i = 0; i < 4; i++)
+                append_frame(stream, bodies[i]);
+
+            CPPUNIT_ASSERT_EQUAL((int)stream.size(), child.send(-1, &stream[0], stream.size()));
+
+            // Frames up to the last one; each good one must come through
+            std::vector<std::string> received;
+            int dropped = 0;
+            while(received.empty() || received.back() != "end"){
+                std::vector<char> body;
+                int status = parent.receive_frame(0, body, true);
+                CPPUNIT_ASSERT(status >= 0);
+
+                if(status == 0)
+                    dropped++;
+                else
+                    received.push_back(std::string(body.begin(), body.end()));
+            }
+
+            CPPUNIT_ASSERT_EQUAL(1, dropped);
+            CPPUNIT_ASSERT_EQUAL((size_t)4, received.size());
+            for(int i = 0; i < 4; i++)
+                CPPUNIT_ASSERT_EQUAL(std::string(bodies[i]), received[i]);
+            CPPUNIT_ASSERT_EQUAL((uint64_t)1, parent.counters(0).checksum_errors);
+        }
+
+    } /* namespace router */
+} /* namespace gr */
@@ -0,0 +1,58 @@
+/* -*- c++ -*- */
+/*
+ * Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _QA_WIRE_SWAP_H_
+#define _QA_WIRE_SWAP_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestCase.h>
+
+namespace gr {
+    namespace router {
+
+        /*!
+         *  Round trips through the wire_format helpers with ROUTER_WIRE_SWAP forced on, the code path of big-endian hosts,
+         *  a root with its children over 127.0.0.1, and a corrupted frame on a link. Built into test-router-wire-swap, together with its own copies of
+         *  the sources that touch the wire.
+         */
+
+        class qa_wire_swap : public CppUnit::TestCase
+        {
+        public:
+            CPPUNIT_TEST_SUITE(qa_wire_swap);
+            CPPUNIT_TEST(t1_segment_header);
+            CPPUNIT_TEST(t2_sample_codecs);
+            CPPUNIT_TEST(t3_tag_table);
+            CPPUNIT_TEST(t4_loopback);
+            CPPUNIT_TEST(t5_corrupt_length);
+            CPPUNIT_TEST_SUITE_END();
+
+        private:
+            void t1_segment_header();
+            void t2_sample_codecs();
+            void t3_tag_table();
+            void t4_loopback();
+            void t5_corrupt_length();
+        };
+
+    } // namespace router
+} // namespace gr
+
+#endif /* _QA_WIRE_SWAP_H_ */
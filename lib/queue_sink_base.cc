@@ -0,0 +1,232 @@
+/* -*- c++ -*- */
+/*
+ *  Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ Important Note
+ This code functions on groups of 768 float values (float segments) or 50 bytes (byte segments).
+ Samples of other types are packed so that every segment still holds a whole number of these windows.
+ See segment_traits.h for the format of the segments.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "queue_sink_base.h"
+#include <router/queue_sink.h>
+#include <router/queue_sink_byte.h>
+#include <router/queue_sink_typed.h>
+#include <stdio.h>
+#include <string.h>
+
+#define VERBOSE false
+
+namespace gr {
+    namespace router {
+
+        /*!
+         *  The constructor shared by all queue sink blocks. The io_signature is set by the concrete block.
+         *
+         *  @param &shared_queue A reference to the fixed-sized lockfree queue in which the segments will be pushed.
+         *  @param preserve_index True if there is an index preserved in the stream tags, and if it is to be preserved in the resulting segments. Else, False.
+         *  @param overlap Samples of history each segment repeats from the end of the previous one (0 for none); rounded up to whole storage items.
+         */
+
+        template <class T, class S, class Base>
+        queue_sink_base<T, S, Base>::queue_sink_base(segment_queue &shared_queue, bool preserve_index, int overlap)
+        : queue(&shared_queue), queue_counter(0), window(NULL), index_of_window(0), preserve(preserve_index), waiting_on_window(false), eos_sent(false), overlap(aligned_overlap<T, S>(overlap))
+        {
+            this->set_output_multiple(output_multiple()); // Guarantee inputs that fill whole windows
+            this->set_history(this->overlap + 1); // The scheduler keeps the last overlap samples in front of the input (zeros before the first segment)
+
+            if(VERBOSE)
+                myfile.open("queue_sink.data");
+        }
+
+        /**
+         *  The destructor for the queue sink blocks.
+         */
+
+        template <class T, class S, class Base>
+        queue_sink_base<T, S, Base>::~queue_sink_base()
+        {
+            delete window;
+        }
+
+        /*!
+         *  Returns the fewest samples that fill a whole number of windows of the storage type (see window_multiple()).
+         */
+
+        template <class T, class S, class Base>
+        int queue_sink_base<T, S, Base>::output_multiple()
+        {
+            return window_multiple<T, S>();
+        }
+
+        /*!
+         *  This is the work() function. It segments the stream, and pushes the resulting segments into the lockfree queue.
+         *
+         *  With an overlap, each segment starts with the last overlap samples of the previous one (overlap-save), so a filter with that
+         *  much history produces the same output on any node; the queue source at the end trims the output of that history again.
+         *
+         *  @param noutput_items The number of data samples
+         *  @param &input_items Pointer to input vector
+         *  @param &output_items Pointer to output vector
+         */
+
+        template <class T, class S, class Base>
+        int
+        queue_sink_base<T, S, Base>::work(int noutput_items,
+                                          gr_vector_const_void_star &input_items,
+                                          gr_vector_void_star &output_items)
+        {
+            const T *in = (const T *) input_items[0]; // Input sample buffer pointer; the overlap samples of history come first
+
+            // If we don't have a segment ready to push... let's make one
+            if(!waiting_on_window){
+
+                const uint64_t nread = this->nitems_read(0); //number of items read on port 0 up until the start of this work function (index of first sample)
+
+                //read all tags associated with port 0 for items in this work function
+                this->get_tags_in_range(tags, 0, nread, nread + noutput_items);
+
+                // Do we want to pull indexes from the stream tags and use those for window indexes?
+                if(preserve){
+                    for(size_t i = 0; i < tags.size(); i++){
+                        if(pmt::eq(tags[i].key, table.index_key()))
+                            indexes.push_back((float)(pmt::to_long(tags[i].value))); // We pull from here when constructing window segments
+                    }
+                }
+
+                // Every other tag rides along in the segment's tag table
+                table.write(tags, nread, noutput_items, sizeof(T), overlap * sizeof(T), table_bytes);
+                tags.clear();
+
+                size_t data_bytes = (overlap + noutput_items) * sizeof(T); // History, then the new samples
+                size_t data_items = (data_bytes + sizeof(S) - 1) / sizeof(S); // Round up to whole storage items
+
+                window = new segment();
+                window->reserve(traits::header_items + data_items + (table_bytes.size() + sizeof(S) - 1) / sizeof(S));
+                traits::write_header(*window, get_index(), (float)data_items);
+                window->resize(traits::header_items + data_items, 0);
+
+                memcpy(&((*window)[traits::header_items]), &in[0], data_bytes);
+                append_tag_table(*window, table_bytes);
+            }
+
+            int push_attempts = 0;
+            waiting_on_window = false; // False unless we can't push 10 times in a row
+
+            // try to push the window 10 times; if that doesn't work, we'll try again next time this block is called
+            while(!queue->push(window)){
+
+                boost::this_thread::sleep(boost::posix_time::microseconds(10)); // wait 10 microsecond
+
+                if(++push_attempts == 10){
+                    waiting_on_window = true;
+                    break;
+                }
+            }
+
+            if(!waiting_on_window){
+                window = NULL; // We're done with this window; it's on the queue
+                queue_counter++; // We have one more outstanding window
+                return noutput_items;
+            }
+            else{
+                return 0;
+            }
+        }
+
+        /*!
+         *  Called by the scheduler once the input stream has ended (and when the flow graph is stopped).
+         *  Pushes the window that could not be pushed yet, then the kill message, so that everything
+         *  downstream of the queue learns that the stream is over and can finish once it is drained.
+         */
+        
+        template <class T, class S, class Base>
+        bool queue_sink_base<T, S, Base>::stop()
+        {
+            if(eos_sent)
+                return true;
+            
+            // Don't lose the tail of the stream
+            if(waiting_on_window){
+                while(!queue->push(window))
+                    boost::this_thread::sleep(boost::posix_time::microseconds(10));
+                
+                window = NULL;
+                waiting_on_window = false;
+                queue_counter++;
+            }
+            
+            segment *kill = new segment();
+            traits::write_kill(*kill);
+            
+            while(!queue->push(kill))
+                boost::this_thread::sleep(boost::posix_time::microseconds(10));
+            
+            eos_sent = true;
+            
+            if(VERBOSE)
+                myfile << "Pushed the kill message after " << queue_counter << " windows" << std::endl;
+            
+            return true;
+        }
+        
+        /*!
+         *  This is the get_index function. It returns a float for the index of the current segment. This index is either pulled from the indexes if the index was preserved with stream tags, or it is generated from 0.
+         *
+         *  @return index_of_window A float representing the index of the current window.
+         */
+
+        template <class T, class S, class Base>
+        float queue_sink_base<T, S, Base>::get_index(){
+
+            // If we do want to preserve index, pull index from stream tags
+            if(preserve){
+                if(indexes.size() > 0){
+                    index_of_window = indexes.front();
+                    indexes.pop_front();
+                }
+                else{
+                    if(VERBOSE)
+                        myfile << "Error: Looking for tag value, but couldn't find any" << std::endl;
+                }
+            }
+
+            // If not preserving an index, start from 0 and incremement for every subsequent window
+            return index_of_window++;
+        }
+
+        template class queue_sink_base<float, float, queue_sink>;
+        template class queue_sink_base<char, char, queue_sink_byte>;
+
+        template class queue_sink_base<gr_complex, float, queue_sink_typed<gr_complex> >;
+        template class queue_sink_base<gr_complex, char, queue_sink_typed<gr_complex> >;
+        template class queue_sink_base<float, float, queue_sink_typed<float> >;
+        template class queue_sink_base<float, char, queue_sink_typed<float> >;
+        template class queue_sink_base<short, float, queue_sink_typed<short> >;
+        template class queue_sink_base<short, char, queue_sink_typed<short> >;
+        template class queue_sink_base<signed char, float, queue_sink_typed<signed char> >;
+        template class queue_sink_base<signed char, char, queue_sink_typed<signed char> >;
+
+    } /* namespace router */
+} /* namespace gr */
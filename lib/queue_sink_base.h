@@ -0,0 +1,96 @@
+/* -*- c++ -*- */
+/*
+ * Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_ROUTER_QUEUE_SINK_BASE_H
+#define INCLUDED_ROUTER_QUEUE_SINK_BASE_H
+
+#include "segment_traits.h"
+#include "tag_table.h"
+#include <vector>
+#include <deque>
+#include <boost/thread.hpp>
+#include <boost/lockfree/queue.hpp>
+#include <gnuradio/sync_block.h>
+#include <iostream>
+#include <fstream>
+
+namespace gr {
+    namespace router {
+
+        /*!
+         *  Shared implementation of all queue sink blocks.
+         *
+         *  T is the type of the samples on the input stream, S is the storage type of the segments
+         *  pushed into the queue (float or char) and Base is the public block interface.
+         */
+
+        template <class T, class S, class Base>
+        class queue_sink_base : public Base
+        {
+        protected:
+
+            typedef std::vector<S> segment;
+            typedef boost::lockfree::queue< segment*, boost::lockfree::fixed_sized<true> > segment_queue;
+            typedef segment_traits<S> traits;
+
+            std::ofstream myfile; // output file stream
+
+            std::vector<gr::tag_t> tags; // Vector of tags pulled from stream
+
+            segment_queue *queue; // Pointer to shared queue
+            int queue_counter; // Counter for windows in queue
+
+            segment *window; // Window buffer for building windows
+            std::deque<float> indexes; // Indexes pulled from the index stream tags, oldest first
+            
+            tag_table table; // Writes the other stream tags into the segments
+            std::vector<char> table_bytes; // The tag table of the window being built
+
+            float index_of_window; // window indexing if not preserved from stream tags
+            bool preserve; // Re-establish index from source?
+
+            bool waiting_on_window; // We still have a window we can't push?
+            
+            bool eos_sent; // The kill message has been pushed
+            
+            int overlap; // Samples of the previous segment repeated at the front of each segment
+
+            float get_index(); // Returns the next index
+
+            queue_sink_base(segment_queue &shared_queue, bool preserve_index, int overlap);
+
+        public:
+            ~queue_sink_base();
+
+            // Number of samples of type T that fill a whole number of windows
+            static int output_multiple();
+
+            int work(int noutput_items,
+                     gr_vector_const_void_star &input_items,
+                     gr_vector_void_star &output_items);
+            
+            // End of stream; push the last window and the kill message
+            bool stop();
+        };
+
+    } // namespace router
+} // namespace gr
+
+#endif /* INCLUDED_ROUTER_QUEUE_SINK_BASE_H */
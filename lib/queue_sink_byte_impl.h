@@ -24,56 +24,23 @@
 #define INCLUDED_ROUTER_QUEUE_SINK_BYTE_IMPL_H
 
 #include <router/queue_sink_byte.h>
-#include <vector>
-#include <boost/thread.hpp>
-#include <algorithm>
-#include <boost/lockfree/queue.hpp>
-#include <memory>
-#include <gnuradio/tagged_stream_block.h>
-#include <iostream>
-#include <fstream>
+#include "queue_sink_base.h"
 
 namespace gr {
   namespace router {
 
-    class queue_sink_byte_impl : public queue_sink_byte
+    class queue_sink_byte_impl : public queue_sink_base<char, char, queue_sink_byte>
     {
      private:
-        std::ofstream myfile;
-        int number_of_windows;
-        int left_over;
-        int out_mult;
-
-        std::vector<gr::tag_t> tags;
-        const char* symbol;
-
-        boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > *queue;
-        int queue_counter;
         int item_size;
 
-        std::vector<char> *window;
-        std::vector<float> *index_vector;
-
-        float index_of_window;
-        bool preserve;
-
-        char* get_index();
-
-        bool waiting_on_window;
-
-
      public:
-      queue_sink_byte_impl(int item_size, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &shared_queue, bool preserve_index);
+      queue_sink_byte_impl(int item_size, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &shared_queue, bool preserve_index, int overlap);
 
       ~queue_sink_byte_impl();
-
-        int work(int noutput_items,
-	       gr_vector_const_void_star &input_items,
-	       gr_vector_void_star &output_items);
     };
 
   } // namespace router
 } // namespace gr
 
 #endif /* INCLUDED_ROUTER_QUEUE_SINK_BYTE_IMPL_H */
-
@@ -0,0 +1,108 @@
+/* -*- c++ -*- */
+/*
+ * Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ The typed queue sinks pack streams of float, complex, short and 8-bit samples into segments; see queue_sink_base.cc
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gnuradio/io_signature.h>
+#include "queue_sink_typed_impl.h"
+
+namespace gr {
+    namespace router {
+        
+        /*!
+         *  The public constructor for a typed queue sink that pushes float (type-1) segments.
+         *
+         *  @param &shared_queue A reference to the fixed-sized lockfree queue in which the segments will be pushed.
+         *  @param preserve_index True if there is an index preserved in the stream tags, and if it is to be preserved in the resulting segments. Else, False.
+         *  @param overlap Samples of history each segment repeats from the end of the previous one (0 for none).
+         *  @return A shared pointer to the queue sink block
+         */
+        
+        template <class T>
+        typename queue_sink_typed<T>::sptr
+        queue_sink_typed<T>::make(boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > &shared_queue, bool preserve_index, int overlap)
+        {
+            return gnuradio::get_initial_sptr (new queue_sink_typed_impl<T, float>(shared_queue, preserve_index, overlap));
+        }
+        
+        /*!
+         *  The public constructor for a typed queue sink that pushes byte (type-2) segments.
+         *
+         *  @param &shared_queue A reference to the fixed-sized lockfree queue in which the segments will be pushed.
+         *  @param preserve_index True if there is an index preserved in the stream tags, and if it is to be preserved in the resulting segments. Else, False.
+         *  @param overlap Samples of history each segment repeats from the end of the previous one (0 for none).
+         *  @return A shared pointer to the queue sink block
+         */
+        
+        template <class T>
+        typename queue_sink_typed<T>::sptr
+        queue_sink_typed<T>::make(boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &shared_queue, bool preserve_index, int overlap)
+        {
+            return gnuradio::get_initial_sptr (new queue_sink_typed_impl<T, char>(shared_queue, preserve_index, overlap));
+        }
+        
+        /*!
+         *  The private constructor of the typed queue sink block.
+         *
+         *  @param &shared_queue A reference to the fixed-sized lockfree queue in which the segments will be pushed.
+         *  @param preserve_index True if there is an index preserved in the stream tags, and if it is to be preserved in the resulting segments. Else, False.
+         *  @param overlap Samples of history each segment repeats from the end of the previous one (0 for none).
+         */
+        
+        template <class T, class S>
+        queue_sink_typed_impl<T, S>::queue_sink_typed_impl(boost::lockfree::queue< std::vector<S>*, boost::lockfree::fixed_sized<true> > &shared_queue, bool preserve_index, int overlap)
+        : gr::sync_block("queue_sink_typed",
+                         gr::io_signature::make(1, 1, sizeof(T)),
+                         gr::io_signature::make(0, 0, 0)),
+          queue_sink_base<T, S, queue_sink_typed<T> >(shared_queue, preserve_index, overlap)
+        {
+        }
+        
+        /**
+         *  The destructor for the typed queue sink block.
+         */
+        
+        template <class T, class S>
+        queue_sink_typed_impl<T, S>::~queue_sink_typed_impl()
+        {
+        }
+        
+        template class queue_sink_typed<gr_complex>;
+        template class queue_sink_typed<float>;
+        template class queue_sink_typed<short>;
+        template class queue_sink_typed<signed char>;
+        
+        template class queue_sink_typed_impl<gr_complex, float>;
+        template class queue_sink_typed_impl<gr_complex, char>;
+        template class queue_sink_typed_impl<float, float>;
+        template class queue_sink_typed_impl<float, char>;
+        template class queue_sink_typed_impl<short, float>;
+        template class queue_sink_typed_impl<short, char>;
+        template class queue_sink_typed_impl<signed char, float>;
+        template class queue_sink_typed_impl<signed char, char>;
+        
+    } /* namespace router */
+} /* namespace gr */
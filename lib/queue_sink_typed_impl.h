@@ -0,0 +1,41 @@
+/* -*- c++ -*- */
+/*
+ * Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_ROUTER_QUEUE_SINK_TYPED_IMPL_H
+#define INCLUDED_ROUTER_QUEUE_SINK_TYPED_IMPL_H
+
+#include <router/queue_sink_typed.h>
+#include "queue_sink_base.h"
+
+namespace gr {
+    namespace router {
+        
+        template <class T, class S>
+        class queue_sink_typed_impl : public queue_sink_base<T, S, queue_sink_typed<T> >
+        {
+        public:
+            queue_sink_typed_impl(boost::lockfree::queue< std::vector<S>*, boost::lockfree::fixed_sized<true> > &shared_queue, bool preserve_index, int overlap);
+            ~queue_sink_typed_impl();
+        };
+        
+    } // namespace router
+} // namespace gr
+
+#endif /* INCLUDED_ROUTER_QUEUE_SINK_TYPED_IMPL_H */
@@ -0,0 +1,412 @@
+/* -*- c++ -*- */
+/*
+ * Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ See segment_traits.h for the format of the segments.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "queue_source_base.h"
+#include <router/queue_source.h>
+#include <router/queue_source_byte.h>
+#include <router/queue_source_typed.h>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+#define VERBOSE false
+
+namespace gr {
+    namespace router {
+
+        /// Compare function used to keep the windows sorted from low to high index
+        template <class S>
+        static bool order_window(const std::vector<S>* a, const std::vector<S>* b){
+            return (segment_traits<S>::index(*a) < segment_traits<S>::index(*b));
+        }
+
+        /*!
+         *	The constructor shared by all queue source blocks. The io_signature is set by the concrete block.
+         *
+         *  @param &shared_queue Reference to queue where segments will be popped from
+         *  @param preserve_index If the index of the segments is to be preserved in the resulting stream, True; else, False
+         *  @param order_data Require that all data parsed from queue segments be in the correct order before streaming.
+         *  @param overlap Samples trimmed from the front of each segment; the output samples of the history a queue sink added (0 for none); rounded up to whole storage items.
+         *  @param reorder_depth With ordering, give up on a missing segment once this many later segments wait behind it (0 for no limit).
+         *  @param reorder_timeout With ordering, give up on a missing segment after waiting this many seconds for it (0 for no limit).
+         */
+
+        template <class T, class S, class Base>
+        queue_source_base<T, S, Base>::queue_source_base(segment_queue &shared_queue, bool preserve_index, bool order_data, int overlap, int reorder_depth, double reorder_timeout)
+        : global_index(0), found_kill(false), order(order_data), queue(&shared_queue), preserve(preserve_index), current(NULL), current_offset(0), overlap(aligned_overlap<T, S>(overlap)), next_tag(0),
+          reorder_depth(reorder_depth > 0 ? reorder_depth : 0), reorder_timeout(reorder_timeout > 0 ? reorder_timeout : 0), stalled(false), skip_until(0), gap_length(1), skipped(0)
+        {
+            this->set_output_multiple(output_multiple()); // Guarantee outputs that fill whole windows
+
+            if(VERBOSE)
+                myfile.open("queue_source.data"); // Dump information to file
+        }
+
+        /*!
+         *	The destructor.
+         */
+
+        template <class T, class S, class Base>
+        queue_source_base<T, S, Base>::~queue_source_base()
+        {
+            delete current;
+
+            for(size_t i = 0; i < local.size(); i++)
+                delete local[i];
+
+            if(VERBOSE){
+                myfile << "Calling Queue_Source Destructor\n";
+                myfile << std::flush;
+                myfile.close();
+            }
+        }
+
+        /*!
+         *  Returns the fewest samples that fill a whole number of windows of the storage type (see window_multiple()).
+         */
+
+        template <class T, class S, class Base>
+        int queue_source_base<T, S, Base>::output_multiple()
+        {
+            return window_multiple<T, S>();
+        }
+
+        /*!
+         *  Returns the number of segments given up on so far.
+         */
+
+        template <class T, class S, class Base>
+        uint64_t queue_source_base<T, S, Base>::segments_skipped()
+        {
+            return skipped.load(boost::memory_order_relaxed);
+        }
+
+        /*!
+         *  Insert a segment into the local vector, keeping it sorted by index.
+         */
+
+        template <class T, class S, class Base>
+        void queue_source_base<T, S, Base>::insert_ordered(segment *seg)
+        {
+            local.insert(std::upper_bound(local.begin(), local.end(), seg, order_window<S>), seg);
+        }
+
+        /*!
+         *  Returns the next segment to be streamed out. If ordering is required, this is the segment with index global_index.
+         *
+         *  @return The next segment, or NULL if there is none ready yet.
+         */
+
+        template <class T, class S, class Base>
+        typename queue_source_base<T, S, Base>::segment* queue_source_base<T, S, Base>::next_segment()
+        {
+            segment *temp_vector; // Temp vector pointer for popping vector pointers off of the shared queue
+
+            // Pop segments off of the shared queue while there are any available
+            while(!found_kill && queue->pop(temp_vector)){
+
+                if(traits::is_kill(*temp_vector)){
+                    found_kill = true;
+                    delete temp_vector;
+                    break;
+                }
+
+                // A gap takes the place of its shed segment, in order like one
+                if(!traits::is_data(*temp_vector) && !traits::is_gap(*temp_vector)){
+                    std::cout << "ERROR: queue_source got a segment of unexpected type" << std::endl;
+                    delete temp_vector;
+                    continue;
+                }
+
+                // If ordering doesn't matter, stream the segments as they come
+                if(!order)
+                    return temp_vector;
+
+                // Too late; its place in the stream was already given up on
+                if((int)traits::index(*temp_vector) < global_index){
+                    if(VERBOSE)
+                        myfile << "Dropping late window; index=" << traits::index(*temp_vector) << std::endl;
+                    
+                    delete temp_vector;
+                    continue;
+                }
+
+                insert_ordered(temp_vector);
+            }
+
+            // Give up on the missing segments ahead of the lowest one we have, once they are overdue
+            if(order && !found_kill && (local.size() > 0) && ((int)traits::index(*local.front()) != global_index) && reorder_expired())
+                skip_until = (int)traits::index(*local.front());
+
+            // The segments given up on leave one gap for the whole run, in order like the segments would have; a stream that joins
+            // late or whose indexes wrap may be missing millions of them
+            if(order && global_index < skip_until){
+
+                if(VERBOSE)
+                    myfile << "Giving up on windows; index=" << global_index << " to " << (skip_until - 1) << std::endl;
+
+                temp_vector = new segment();
+                traits::write_gap(*temp_vector, (float)global_index);
+                gap_length = skip_until - global_index;
+                skipped.fetch_add(gap_length, boost::memory_order_relaxed);
+                global_index = skip_until;
+                stalled = false;
+                return temp_vector;
+            }
+
+            // Once the kill message is in, nothing else is coming; drain the reorder buffer in order, skipping over the missing indexes
+            if(order && found_kill && (local.size() > 0) && ((int)traits::index(*local.front()) != global_index)){
+                
+                if(VERBOSE)
+                    myfile << "End of stream; skipping from index " << global_index << " to " << traits::index(*local.front()) << std::endl;
+                
+                global_index = (int)traits::index(*local.front());
+            }
+            
+            if(order && (local.size() > 0) && ((int)traits::index(*local.front()) == global_index)){
+
+                if(VERBOSE)
+                    myfile << "Got the next window; index=" << global_index << std::endl;
+
+                temp_vector = local.front();
+                local.erase(local.begin()); // Remove the pointer from the local vector
+                global_index++;
+                stalled = false;
+                return temp_vector;
+            }
+
+            if(VERBOSE && order && (local.size() > 0))
+                myfile << "Looking for: " << global_index << " but our lowest index is: " << traits::index(*local.front()) << "\n" << std::flush;
+
+            return NULL;
+        }
+
+        /*!
+         *  Called while the segment with index global_index is missing and later ones are in. It is given up on once reorder_depth
+         *  segments wait behind it, or once it has been waited for reorder_timeout seconds.
+         *
+         *  @return True if the missing segment is overdue.
+         */
+
+        template <class T, class S, class Base>
+        bool queue_source_base<T, S, Base>::reorder_expired()
+        {
+            if(reorder_depth > 0 && (int)local.size() >= reorder_depth)
+                return true;
+
+            if(reorder_timeout <= 0)
+                return false;
+
+            boost::system_time now = boost::get_system_time();
+
+            if(!stalled){
+                stalled = true;
+                stall_start = now;
+                return false;
+            }
+
+            return (now - stall_start).total_microseconds() >= (long)(reorder_timeout * 1e6);
+        }
+
+        /*!
+         *  Writes an index stream tag on output port 0.
+         *
+         *  @param offset The absolute offset of the sample to tag.
+         *  @param index The index of the segment starting at that sample.
+         */
+
+        template <class T, class S, class Base>
+        void queue_source_base<T, S, Base>::write_index_tag(uint64_t offset, float index)
+        {
+            gr::tag_t temp_tag;
+            temp_tag.key = table.index_key(); // Key associated with the index
+            temp_tag.value = pmt::from_long((long)index); // Have to cast index to long (pmt does not handle floats)
+            temp_tag.offset = offset;
+
+            this->add_item_tag(0, temp_tag); // write <index> to stream at location stream = 0+offset with key = key
+
+            if(VERBOSE)
+                myfile << "Writing stream tag: (key=i, offset=" << offset << ", value=" << index << "\n" << std::flush;
+        }
+
+        /*!
+         *  Writes a gap stream tag on output port 0, in place of a segment that missed its deadline and was shed, or of a run of
+         *  segments that ordering gave up on. Its value is the pair (index . count).
+         *
+         *  @param offset The absolute offset of the sample that follows the gap.
+         *  @param index The index of the first missing segment.
+         *  @param count The number of missing segments.
+         */
+
+        template <class T, class S, class Base>
+        void queue_source_base<T, S, Base>::write_gap_tag(uint64_t offset, float index, int count)
+        {
+            gr::tag_t temp_tag;
+            temp_tag.key = table.gap_key();
+            temp_tag.value = pmt::cons(pmt::from_long((long)index), pmt::from_long(count));
+            temp_tag.offset = offset;
+
+            this->add_item_tag(0, temp_tag);
+
+            if(VERBOSE)
+                myfile << "Writing gap tag: (offset=" << offset << ", index=" << index << ", count=" << count << ")\n" << std::flush;
+        }
+
+        /// Compare function used to keep the carried tags sorted by offset
+        static bool order_tag(const gr::tag_t &a, const gr::tag_t &b){
+            return a.offset < b.offset;
+        }
+
+        /*!
+         *  Writes the stream tags carried by the current segment for the samples about to be streamed out.
+         *
+         *  @param offset The absolute offset of the first of those samples.
+         *  @param count The number of samples.
+         */
+
+        template <class T, class S, class Base>
+        void queue_source_base<T, S, Base>::write_carried_tags(uint64_t offset, size_t count)
+        {
+            while(next_tag < current_tags.size()){
+                gr::tag_t tag = current_tags[next_tag];
+                size_t sample = tag.offset / sizeof(T);
+
+                if(sample >= current_offset + count)
+                    break;
+
+                // Tags of the trimmed overlap are dropped with it
+                if(sample >= current_offset){
+                    tag.offset = offset + (sample - current_offset);
+                    this->add_item_tag(0, tag);
+                }
+                next_tag++;
+            }
+        }
+
+        /*!
+         *	The objective of the work() function is to grab windows from the shared_queue and dump their contents into the out memory buffer.
+         *
+         *  If required, the windows are ordered prior to dumping their contents to maintain order across the flow graph.
+         *
+         *  Also, if the index of the window is to be maintained, the indexes are shared via stream tags.
+         *
+         *  Segments larger than the output buffer are streamed out over several calls, and the first overlap samples of each segment are dropped.
+         *  A segment the root shed is replaced by a gap tag (key "gap", value the pair (index . 1)) on the sample that follows it.
+         *  A run of segments that ordering gave up on (see reorder_expired()) gets one gap tag, (first index . count); they are
+         *  dropped if they arrive after all.
+         */
+
+        template <class T, class S, class Base>
+        int
+        queue_source_base<T, S, Base>::work(int noutput_items,
+                                            gr_vector_const_void_star &input_items,
+                                            gr_vector_void_star &output_items)
+        {
+            char *out = (char *) output_items[0]; // output buffer pointer (where we're writing the samples to)
+            int produced = 0;
+
+            while(produced < noutput_items){
+
+                if(current == NULL){
+
+                    current = next_segment();
+
+                    if(current == NULL)
+                        break;
+
+                    // Nothing to stream for a shed segment; mark where it would have been
+                    if(traits::is_gap(*current)){
+                        write_gap_tag(this->nitems_written(0) + produced, traits::index(*current), gap_length);
+                        gap_length = 1; // The gaps of shed segments each stand for one
+                        delete current;
+                        current = NULL;
+                        continue;
+                    }
+
+                    // Skip the output of the history the segment was given (overlap-save)
+                    current_offset = std::min((size_t)overlap, ((size_t)traits::size(*current) * sizeof(S)) / sizeof(T));
+
+                    // The other stream tags that came with the segment
+                    size_t table_size;
+                    const char *table_data = segment_tag_table(*current, table_size);
+                    if(!table.read(table_data, table_size, current_tags))
+                        std::cout << "ERROR: queue_source got a segment with a malformed tag table" << std::endl;
+                    std::stable_sort(current_tags.begin(), current_tags.end(), order_tag);
+                    next_tag = 0;
+
+                    //If we want to preserve index, write an index stream tag on the first sample of the segment
+                    if(preserve)
+                        write_index_tag(this->nitems_written(0) + produced, traits::index(*current));
+                }
+
+                size_t segment_samples = ((size_t)traits::size(*current) * sizeof(S)) / sizeof(T);
+                size_t count = std::min(segment_samples - current_offset, (size_t)(noutput_items - produced));
+
+                if(count > 0){
+                    write_carried_tags(this->nitems_written(0) + produced, count);
+
+                    const char *data = (const char *) &((*current)[traits::header_items]); // Data starts right after the header
+                    memcpy(&out[produced * sizeof(T)], data + current_offset * sizeof(T), count * sizeof(T));
+
+                    produced += count;
+                    current_offset += count;
+                }
+
+                // We're done with this segment
+                if(current_offset >= segment_samples){
+                    delete current;
+                    current = NULL;
+                }
+            }
+
+            if(produced > 0)
+                return produced;
+
+            // Everything before the kill message (including the reorder buffer) has been streamed out
+            if(found_kill && local.size() == 0)
+                return -1;
+
+            // If none available, wait
+            boost::this_thread::sleep(boost::posix_time::microseconds(100)); // Arbitrary sleep time
+            return 0;
+        }
+
+        template class queue_source_base<float, float, queue_source>;
+        template class queue_source_base<char, char, queue_source_byte>;
+
+        template class queue_source_base<gr_complex, float, queue_source_typed<gr_complex> >;
+        template class queue_source_base<gr_complex, char, queue_source_typed<gr_complex> >;
+        template class queue_source_base<float, float, queue_source_typed<float> >;
+        template class queue_source_base<float, char, queue_source_typed<float> >;
+        template class queue_source_base<short, float, queue_source_typed<short> >;
+        template class queue_source_base<short, char, queue_source_typed<short> >;
+        template class queue_source_base<signed char, float, queue_source_typed<signed char> >;
+        template class queue_source_base<signed char, char, queue_source_typed<signed char> >;
+
+    } /* namespace router */
+} /* namespace gr */
@@ -0,0 +1,120 @@
+/* -*- c++ -*- */
+/*
+ *  Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_ROUTER_QUEUE_SOURCE_BASE_H
+#define INCLUDED_ROUTER_QUEUE_SOURCE_BASE_H
+
+#include "segment_traits.h"
+#include "tag_table.h"
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/atomic.hpp>
+#include <boost/lockfree/queue.hpp>
+#include <gnuradio/sync_block.h>
+#include <iostream>
+#include <fstream>
+
+namespace gr {
+    namespace router {
+
+        /*!
+         *  Shared implementation of all queue source blocks.
+         *
+         *  T is the type of the samples on the output stream, S is the storage type of the segments
+         *  popped from the queue (float or char) and Base is the public block interface.
+         */
+
+        template <class T, class S, class Base>
+        class queue_source_base : public Base
+        {
+        protected:
+
+            typedef std::vector<S> segment;
+            typedef boost::lockfree::queue< segment*, boost::lockfree::fixed_sized<true> > segment_queue;
+            typedef segment_traits<S> traits;
+
+            std::ofstream myfile; // output file stream
+
+            int global_index; // Current Index to maintain ordering
+
+            bool found_kill; // Received kill message
+
+            bool order; // Do we need to enforce ordering of leaving Windows' data?
+            std::vector<segment*> local; // Local vector for ordering; sorted from low to high index
+
+            segment_queue *queue;
+
+            bool preserve; // Preserve indexes across flow graph
+
+            segment *current; // Segment currently being streamed out
+            size_t current_offset; // Number of samples of the current segment already streamed out
+            
+            int overlap; // Samples at the front of each segment that only warmed up the flow graph; never streamed out
+            
+            tag_table table; // Reads the stream tags carried by the segments
+            std::vector<gr::tag_t> current_tags; // Tags of the current segment, by byte offset into its data field
+            size_t next_tag; // First tag of the current segment not written yet
+            
+            // Live streams: a missing segment is given up on after reorder_depth later segments, or reorder_timeout seconds (0 for no limit)
+            int reorder_depth;
+            double reorder_timeout;
+            bool stalled; // Waiting for the segment with index global_index while later ones are in
+            boost::system_time stall_start;
+            int skip_until; // Indexes below this one were given up on; they get one gap for the whole run
+            int gap_length; // Segments the gap returned by next_segment() stands for
+            boost::atomic<uint64_t> skipped; // Segments given up on
+
+            // Return the next segment to stream out, or NULL if none is ready
+            segment* next_segment();
+
+            // Has the missing segment with index global_index been waited for long enough?
+            bool reorder_expired();
+
+            // Insert a segment into the local ordering vector
+            void insert_ordered(segment *seg);
+
+            // Write an index stream tag at the given absolute offset
+            void write_index_tag(uint64_t offset, float index);
+
+            // Write a gap stream tag at the given absolute offset, for count missing segments from this index on
+            void write_gap_tag(uint64_t offset, float index, int count);
+            
+            // Write the carried tags of samples [current_offset, current_offset + count) of the current segment, from the absolute offset on
+            void write_carried_tags(uint64_t offset, size_t count);
+
+            queue_source_base(segment_queue &shared_queue, bool preserve_index, bool order_data, int overlap, int reorder_depth, double reorder_timeout);
+
+        public:
+            ~queue_source_base();
+
+            // Number of samples of type T that fill a whole number of windows
+            static int output_multiple();
+
+            uint64_t segments_skipped();
+
+            int work(int noutput_items,
+                     gr_vector_const_void_star &input_items,
+                     gr_vector_void_star &output_items);
+        };
+
+    } // namespace router
+} // namespace gr
+
+#endif /* INCLUDED_ROUTER_QUEUE_SOURCE_BASE_H */
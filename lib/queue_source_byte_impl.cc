@@ -19,13 +19,7 @@
  */
 
 /*
- Format of Segments
- |
- byte < type :: [0] > -- contains the message type (2)
- byte * 4 (float)< index :: [1,2,3,4] > -- contains the index of the window
- byte * 4 (float)< size :: [2,3,4,5] > -- contains the size of the data in the data field to come next
- byte * 50 < data :: [6,<data_size + 6 - 1] > -- contains data followed by zeros
- |
+ The byte queue source streams out the data of type-2 segments; see queue_source_base.cc
  */
 
 #ifdef HAVE_CONFIG_H
@@ -34,19 +28,11 @@
 
 #include <gnuradio/io_signature.h>
 #include "queue_source_byte_impl.h"
-#include <stdio.h>
-
-#define VERBOSE false
 
 
 namespace gr {
     namespace router {
         
-        /// Compare function used by std::sort to sort the windows from low to high index
-        bool order_window(const std::vector<char>* a, const std::vector<char>* b){
-            return(a->at(1) < b->at(1));
-        }
-        
         /*!
          *	The public constructor for the queue source byte block
          *
@@ -54,13 +40,16 @@ namespace gr {
          *  @param &shared_queue Reference to queue where segments will be popped from
          *  @param preserve_index If the index of the segments is to be preserved in the resulting stream, True; else, False
          *  @param order Require that all data parsed from queue segments be in the correct order before streaming.
+         *  @param overlap Samples trimmed from the front of each segment; the output samples of the history a queue sink added (0 for none).
+         *  @param reorder_depth With ordering, give up on a missing segment once this many later segments wait behind it (0 for no limit).
+         *  @param reorder_timeout With ordering, give up on a missing segment after waiting this many seconds for it (0 for no limit).
          */
         
         queue_source_byte::sptr
-        queue_source_byte::make(int item_size, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &shared_queue, bool preserve_index, bool order)
+        queue_source_byte::make(int item_size, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &shared_queue, bool preserve_index, bool order, int overlap, int reorder_depth, double reorder_timeout)
         {
             return gnuradio::get_initial_sptr
-            (new queue_source_byte_impl(item_size, shared_queue, preserve_index, order));
+            (new queue_source_byte_impl(item_size, shared_queue, preserve_index, order, overlap, reorder_depth, reorder_timeout));
         }
         
         /*!
@@ -70,28 +59,17 @@ namespace gr {
          *  @param &shared_queue Reference to queue where segments will be popped from
          *  @param preserve_index If the index of the segments is to be preserved in the resulting stream, True; else, False
          *  @param order_data Require that all data parsed from queue segments be in the correct order before streaming.
+         *  @param overlap Samples trimmed from the front of each segment; the output samples of the history a queue sink added (0 for none).
+         *  @param reorder_depth With ordering, give up on a missing segment once this many later segments wait behind it (0 for no limit).
+         *  @param reorder_timeout With ordering, give up on a missing segment after waiting this many seconds for it (0 for no limit).
          */
         
-        queue_source_byte_impl::queue_source_byte_impl(int size, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &shared_queue, bool preserve_index, bool order_data)
+        queue_source_byte_impl::queue_source_byte_impl(int size, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &shared_queue, bool preserve_index, bool order_data, int overlap, int reorder_depth, double reorder_timeout)
         : gr::sync_block("queue_source_byte",
                          gr::io_signature::make(0, 0, 0),
-                         gr::io_signature::make(1, 1, size)), queue(&shared_queue), item_size(size), preserve(preserve_index), order(order_data)
+                         gr::io_signature::make(1, 1, size)),
+          queue_source_base<char, char, queue_source_byte>(shared_queue, preserve_index, order_data, overlap, reorder_depth, reorder_timeout), item_size(size)
         {
-            set_output_multiple(50); // 50 bytes per packet
-            dead = false;
-            
-            if(VERBOSE)
-                myfile.open("queue_source_byte.data");
-            
-            global_index = 0;
-            
-            if(VERBOSE){
-                myfile << "Calling QUEUE_SOURCE_BYTE Constructor\n\n";
-                myfile << std::flush;
-            }
-            
-            found_kill = false;
-            
         }
         
         /*!
@@ -100,60 +78,7 @@ namespace gr {
         
         queue_source_byte_impl::~queue_source_byte_impl()
         {
-            
-            if(VERBOSE){
-                std::cout << "*Calling Queue_Source_Byte Destructor*" << std::endl;
-                myfile << "Calling Queue_Source_Byte Destructor\n";
-                myfile << std::flush;
-                myfile.close();
-            }
-        }
-        
-        /*!
-         *	The objective of the work() function is to grab windows from the shared_queue and dump their contents into the out memory buffer.
-         *
-         *  If required, the windows are ordered prior to dumping their contents to maintain order across the flow graph.
-         *
-         *  Also, if the index of the window is to be maintained, the indexes are shared via stream tags.
-         *
-         */
-        
-        int
-        queue_source_byte_impl::work(int noutput_items,
-                                     gr_vector_const_void_star &input_items,
-                                     gr_vector_void_star &output_items)
-        {
-            char *out = (char *) output_items[0];
-            
-            std::vector<char> *temp_vector;
-            std::vector<char> buffer;
-            
-            float index;
-            float data_size;
-            
-            if(queue->pop(temp_vector)){
-                
-                char type = temp_vector->at(0);
-                
-                switch(type){
-                    case '2':
-                        memcpy(&index, &(temp_vector->at(1)), 4);
-                        memcpy(&data_size, &(temp_vector->at(5)), 4);
-                        memcpy(out, &(temp_vector->at(9)), data_size);
-                        
-                        delete temp_vector;
-                        
-                        return data_size;
-                        break;
-                }
-                
-            }
-            else{
-                boost::this_thread::sleep(boost::posix_time::microseconds(100));
-                return 0;
-            }
         }
         
     } /* namespace router */
 } /* namespace gr */
-
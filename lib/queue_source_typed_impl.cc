@@ -0,0 +1,117 @@
+/* -*- c++ -*- */
+/*
+ * Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ The typed queue sources stream out the data of segments as float, complex, short and 8-bit samples; see queue_source_base.cc
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gnuradio/io_signature.h>
+#include "queue_source_typed_impl.h"
+
+namespace gr {
+    namespace router {
+        
+        /*!
+         *  The public constructor for a typed queue source that pops float (type-1) segments.
+         *
+         *  @param &shared_queue Reference to queue where segments will be popped from
+         *  @param preserve_index If the index of the segments is to be preserved in the resulting stream, True; else, False
+         *  @param order Require that all data parsed from queue segments be in the correct order before streaming.
+         *  @param overlap Samples trimmed from the front of each segment; the output samples of the history a queue sink added (0 for none).
+         *  @param reorder_depth With ordering, give up on a missing segment once this many later segments wait behind it (0 for no limit).
+         *  @param reorder_timeout With ordering, give up on a missing segment after waiting this many seconds for it (0 for no limit).
+         *  @return A shared pointer to the queue source block
+         */
+        
+        template <class T>
+        typename queue_source_typed<T>::sptr
+        queue_source_typed<T>::make(boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > &shared_queue, bool preserve_index, bool order, int overlap, int reorder_depth, double reorder_timeout)
+        {
+            return gnuradio::get_initial_sptr (new queue_source_typed_impl<T, float>(shared_queue, preserve_index, order, overlap, reorder_depth, reorder_timeout));
+        }
+        
+        /*!
+         *  The public constructor for a typed queue source that pops byte (type-2) segments.
+         *
+         *  @param &shared_queue Reference to queue where segments will be popped from
+         *  @param preserve_index If the index of the segments is to be preserved in the resulting stream, True; else, False
+         *  @param order Require that all data parsed from queue segments be in the correct order before streaming.
+         *  @param overlap Samples trimmed from the front of each segment; the output samples of the history a queue sink added (0 for none).
+         *  @param reorder_depth With ordering, give up on a missing segment once this many later segments wait behind it (0 for no limit).
+         *  @param reorder_timeout With ordering, give up on a missing segment after waiting this many seconds for it (0 for no limit).
+         *  @return A shared pointer to the queue source block
+         */
+        
+        template <class T>
+        typename queue_source_typed<T>::sptr
+        queue_source_typed<T>::make(boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &shared_queue, bool preserve_index, bool order, int overlap, int reorder_depth, double reorder_timeout)
+        {
+            return gnuradio::get_initial_sptr (new queue_source_typed_impl<T, char>(shared_queue, preserve_index, order, overlap, reorder_depth, reorder_timeout));
+        }
+        
+        /*!
+         *  The private constructor of the typed queue source block.
+         *
+         *  @param &shared_queue Reference to queue where segments will be popped from
+         *  @param preserve_index If the index of the segments is to be preserved in the resulting stream, True; else, False
+         *  @param order Require that all data parsed from queue segments be in the correct order before streaming.
+         *  @param overlap Samples trimmed from the front of each segment; the output samples of the history a queue sink added (0 for none).
+         *  @param reorder_depth With ordering, give up on a missing segment once this many later segments wait behind it (0 for no limit).
+         *  @param reorder_timeout With ordering, give up on a missing segment after waiting this many seconds for it (0 for no limit).
+         */
+        
+        template <class T, class S>
+        queue_source_typed_impl<T, S>::queue_source_typed_impl(boost::lockfree::queue< std::vector<S>*, boost::lockfree::fixed_sized<true> > &shared_queue, bool preserve_index, bool order, int overlap, int reorder_depth, double reorder_timeout)
+        : gr::sync_block("queue_source_typed",
+                         gr::io_signature::make(0, 0, 0),
+                         gr::io_signature::make(1, 1, sizeof(T))),
+          queue_source_base<T, S, queue_source_typed<T> >(shared_queue, preserve_index, order, overlap, reorder_depth, reorder_timeout)
+        {
+        }
+        
+        /**
+         *  The destructor for the typed queue source block.
+         */
+        
+        template <class T, class S>
+        queue_source_typed_impl<T, S>::~queue_source_typed_impl()
+        {
+        }
+        
+        template class queue_source_typed<gr_complex>;
+        template class queue_source_typed<float>;
+        template class queue_source_typed<short>;
+        template class queue_source_typed<signed char>;
+        
+        template class queue_source_typed_impl<gr_complex, float>;
+        template class queue_source_typed_impl<gr_complex, char>;
+        template class queue_source_typed_impl<float, float>;
+        template class queue_source_typed_impl<float, char>;
+        template class queue_source_typed_impl<short, float>;
+        template class queue_source_typed_impl<short, char>;
+        template class queue_source_typed_impl<signed char, float>;
+        template class queue_source_typed_impl<signed char, char>;
+        
+    } /* namespace router */
+} /* namespace gr */
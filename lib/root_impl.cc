@@ -24,9 +24,20 @@
 
 #include <gnuradio/io_signature.h>
 #include "root_impl.h"
+#include "wire_format.h"
+#include "segment_traits.h"
+#include "tag_table.h"
+#include "affinity.h"
+#include <algorithm>
 
 #define VERBOSE false
 
+// Children with more bytes than this waiting in their outbound queue are skipped by the scheduler
+#define MAX_QUEUED_BYTES (4 * 1024 * 1024)
+
+// Segments pulled from the input queue to wait for their deadline
+#define EDF_WINDOW 256
+
 namespace gr {
  	namespace router {
         
@@ -38,12 +49,18 @@ namespace gr {
          *  @param &input_queue Reference to input queue to push computable segments to.
          *  @param &output_queue Reference to output queue to pop result segments from.
          *  @param throughput The maximum rate at which segments are popped from the output queue
+         *  @param sample_codec The codec proposed to the children for the samples sent to them
+         *  @param result_codec The codec proposed to the children for the results they send back
+         *  @param checksum Protect every segment on the links with a CRC32C trailer
+         *  @param send_workers The number of sender threads that share the children between them
+         *  @param options The socket options of the links to the children
+         *  @param scheduling How the segments are spread over the children
          */
         
  		root::sptr
- 		root::make(int number_of_children, boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > &input_queue, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &output_queue, double throughput)
+ 		root::make(int number_of_children, boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > &input_queue, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &output_queue, double throughput, int sample_codec, int result_codec, bool checksum, int send_workers, const connection_options &options, const scheduler_options &scheduling)
  		{
- 			return gnuradio::get_initial_sptr (new root_impl(number_of_children, input_queue, output_queue, throughput));
+ 			return gnuradio::get_initial_sptr (new root_impl(number_of_children, input_queue, output_queue, throughput, sample_codec, result_codec, checksum, send_workers, options, scheduling));
  		}
         
         /*!
@@ -53,12 +70,18 @@ namespace gr {
          *  @param &input_queue Reference to input queue to push computable segments to.
          *  @param &output_queue Reference to output queue to pop result segments from.
          *  @param throughput The maximum rate at which segments are popped from the output queue
+         *  @param sample_codec The codec proposed to the children for the samples sent to them
+         *  @param result_codec The codec proposed to the children for the results they send back
+         *  @param checksum Protect every segment on the links with a CRC32C trailer
+         *  @param send_workers The number of sender threads that share the children between them
+         *  @param options The socket options of the links to the children
+         *  @param scheduling Sticky runs, the local lane, work stealing and deadlines (see scheduler_options.h)
          */
         
-        root_impl::root_impl(int numberofchildren, boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > &input_queue, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &output_queue, double throughput)
+        root_impl::root_impl(int numberofchildren, boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > &input_queue, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &output_queue, double throughput, int sample_codec, int result_codec, bool checksum, int sendworkers, const connection_options &options, const scheduler_options &scheduling)
         : gr::sync_block("root",
                          gr::io_signature::make(0,0,0),
-                         gr::io_signature::make(0,0,0)), number_of_children(numberofchildren), in_queue(&input_queue), out_queue(&output_queue), d_throughput(throughput)
+                         gr::io_signature::make(0,0,0)), number_of_children(numberofchildren), d_virtual_time(0), next_index(0), d_tree_ended(false), d_throughput(throughput), d_sample_codec(sample_codec), d_result_codec(result_codec), d_checksum(checksum), d_affinity_run(std::max(1, scheduling.affinity_run)), d_run_child(0), d_run_left(0), local_in(scheduling.local_in), local_out(scheduling.local_out), local_lane((scheduling.local_in != NULL && scheduling.local_out != NULL) ? numberofchildren : -1), number_of_lanes(numberofchildren + ((local_lane >= 0) ? 1 : 0)), d_local_threshold(std::max(1, scheduling.local_threshold)), local_outstanding(0), d_steal_depth(std::max(0, scheduling.steal_depth)), d_draining(false), steals_pending(0), d_sample_rate(std::max(0.0, scheduling.sample_rate)), d_latency(scheduling.latency), lane_period_us(number_of_lanes, 0), lane_last_result(number_of_lanes), lane_busy(number_of_lanes, false), d_shed(0), d_late(0)
         {
             
             // Throughput stuff ----------
@@ -75,27 +98,62 @@ namespace gr {
             
             num_killed = 0;
             
-    		// Set global counter; no need to lock -> no contention
-         	global_counter = 0;
+            // Stream 0 is the queue pair given here
+            streams.push_back(input_stream(&input_queue, &output_queue, 1));
+            
+    		// Nothing outstanding yet
+         	outstanding = new boost::atomic<int>[number_of_children];
+         	for(int i = 0; i < number_of_children; i++)
+         		outstanding[i].store(0, boost::memory_order_relaxed);
             
             // Communication connector between nodes (size of elements, number of children, port number, are we root?)
-    		connector =  new NetworkInterface(sizeof(char), number_of_children, 8080, true);
+    		connector =  new NetworkInterface(sizeof(char), number_of_children, 8080, true, options);
             
     	   	// Interconnect all blocks (we're root, so localhost=NULL)
     		connector->connect(NULL);
             
+            // Agree on the wire codecs with every child before any segments are sent
+            d_result_word_size = options.result_word_size;
+            if(d_result_word_size != 1 && d_result_word_size != 2 && d_result_word_size != 4){
+                std::cout << "ERROR: Results cannot have words of " << d_result_word_size << " bytes; sending them as bytes" << std::endl;
+                d_result_word_size = 1;
+            }
+            
+            sample_codecs = new int[number_of_children];
+            result_codecs = new int[number_of_children];
+            checksums = new bool[number_of_children];
+            steals = new bool[number_of_children];
+            
+            // No child is being stolen from yet
+            steal_thief = new int[number_of_children];
+            for(int i = 0; i < number_of_children; i++)
+                steal_thief[i] = -1;
+            
+            for(int i = 0; i < number_of_children; i++)
+                negotiate(i);
+            
+            // From here on, segments are queued per child and written by the connector's writer thread
+            connector->start_writer();
+            
         	// Initialize counters for both queues to 0 (not sure we need this)
-    		in_queue_counter = 0;
-    		out_queue_counter = 0;
             
-    	  	// Array of weights values for each child + local (index 0)
-    		weights = new float[number_of_children];
+    	  	// Array of weights values for each child (the local lane is balanced by its outstanding segments)
+    		weights = new boost::atomic<int>[number_of_children];
+    		for(int i = 0; i < number_of_children; i++)
+    			weights[i].store(0, boost::memory_order_relaxed);
             
     	   	// Finished flag for threads(true if finished)
     		d_finished = false;
             
-            // Thread for parent to send
-            send_thread = boost::shared_ptr< boost::thread >(new boost::thread(boost::bind(&root_impl::send, this)));
+            // One to number_of_children sender workers, each with its own shard of the children
+            send_workers = std::max(1, std::min(sendworkers, number_of_children));
+            
+            for(int w = 0; w < send_workers; w++)
+                shards.push_back(new send_shard());
+            
+            // Threads for parent to send
+            for(int w = 0; w < send_workers; w++)
+                send_threads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&root_impl::send, this, _1), w)));
             
             // Threads for parent to receive from all children
     		for(int i = 0; i < number_of_children; i++){
@@ -108,6 +166,10 @@ namespace gr {
                 
             }
             
+            // Thread that merges the results of the local lane
+            if(local_lane >= 0)
+                local_thread = boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&root_impl::receive_local, this)));
+            
         	if(VERBOSE){
           		std::cout << "Finished calling Root Router's Constructor" << std::endl;
           		myfile << "Calling Root Router Constructor v.2\n" << std::flush;
@@ -127,10 +189,13 @@ namespace gr {
             }
             
             d_finished = true;
+            connector->stop(); // Wakes the threads blocked on the links
             
-            // Join the send thread
-            send_thread->interrupt();
-            send_thread->join();
+            // Join the sender workers
+            for(int w = 0; w < send_workers; w++){
+                send_threads[w]->interrupt();
+                send_threads[w]->join();
+            }
             
             // Join all of the child receiver threads
          	for(int i = 0; i < number_of_children; i++){
@@ -138,9 +203,33 @@ namespace gr {
          		thread_vector[i]->join();
          	}
             
+            if(local_thread){
+                local_thread->interrupt();
+                local_thread->join();
+            }
+            
             // Delete connector object and weights array
             delete connector;
             delete[] weights;
+            delete[] outstanding;
+            delete[] sample_codecs;
+            delete[] result_codecs;
+            delete[] checksums;
+            delete[] steals;
+            delete[] steal_thief;
+            
+            // Segments that never got their turn
+            for(size_t i = 0; i < waiting.size(); i++)
+                delete waiting[i].segment;
+            for(size_t s = 0; s < streams.size(); s++)
+                delete streams[s].head;
+            
+            // Segments that were assigned but never sent
+            for(int w = 0; w < send_workers; w++){
+                for(size_t i = 0; i < shards[w]->items.size(); i++)
+                    delete shards[w]->items[i].segment;
+                delete shards[w];
+            }
             
         }
         
@@ -152,7 +241,7 @@ namespace gr {
         root_impl::work(int noutput_items, gr_vector_const_void_star &input_items, gr_vector_void_star &output_items)
         {
          	//return noutput_items;
-            if(d_finished || (num_killed == number_of_children)){
+            if(d_finished || (num_killed == number_of_lanes)){
                 d_finished = true;
                 return -1; // We're done
             }
@@ -162,21 +251,26 @@ namespace gr {
         }
         
         /*!
-         *	Sender thread: Send segments from a queue to children.
+         *	Sender worker: Assign segments from the input queue to children, and send the segments assigned to the children this worker owns.
+         *
+         *  Whichever worker is idle pulls the next segment from the input queue, so the dispatching is shared between the workers.
+         *  The child is always chosen by min() over all of the children, so the load balancing stays global; the segment is then
+         *  handed to the worker that owns that child, which encodes it and queues it on the link.
          *
-         *  Include packet format infromation in xml file ... functionality will be added later
+         *  @param worker The index of this worker.
          */
         
-        void root_impl::send(){
-            
-            std::vector<float> *temp; // Pointer to current vector of floats to be sent
-            int sent = 0;
+        void root_impl::send(int worker){
             
-            int index, data_size, window_count, packet_size;
+            place_thread(ROLE_SEND, worker);
             
      	    // Until the program exits, continue sending
      	    while(!d_finished){
                 
+                // Segments already assigned to our children come first
+                if(drain(worker))
+                    continue;
+                
                 // Throughput Stuff------
                 // Code derived from throughput block
                 
@@ -184,99 +278,658 @@ namespace gr {
                 boost::int64_t ticks = (now - d_start).ticks(); // total number of ticks since start time
                 uint64_t expected_samples = uint64_t(d_samples_per_tick * ticks); // The total number of samples we expect to pass through since then
                 
-                if(d_total_samples > expected_samples){
-                    boost::this_thread::sleep(boost::posix_time::microseconds(long((d_total_samples - expected_samples) / d_samples_per_us)));
+                uint64_t total_samples;
+                {
+                    boost::mutex::scoped_lock lock(dispatch_lock); // The dispatcher counts the samples and moves the runs on
+                    total_samples = d_total_samples;
+                }
+                
+                if(total_samples > expected_samples){
+                    boost::this_thread::sleep(boost::posix_time::microseconds(long((total_samples - expected_samples) / d_samples_per_us)));
                 }
                 
                 //----------
                 
-		        int min_weight = weights[min()];
+                // The next segment has nowhere to go; let the writer drain the queues before taking another segment
+                // (with deadlines, the waiting segments are still shed in the meantime)
+                bool backed_up = false;
+                if(d_sample_rate <= 0){
+                    boost::mutex::scoped_lock lock(dispatch_lock);
+                    backed_up = (target() < 0);
+                }
+                
+                if(backed_up){
+                    boost::this_thread::sleep(boost::posix_time::microseconds(100));
+                    continue;
+                }
+                
+                // Nothing to dispatch; wait until another worker hands us a segment, or a while to poll the input queue again
+                if(!dispatch()){
+                    send_shard *shard = shards[worker];
+                    boost::unique_lock<boost::mutex> lock(shard->lock);
+                    if(shard->items.empty())
+                        shard->ready.timed_wait(lock, boost::posix_time::microseconds(1000));
+                }
+                // Future Work: Include additonal code for redundancy; keep copy of window until it has been ACKd;; Is this required given we're using TCP?
+                
+            }
+        }
+        
+        /*!
+         *  Take the next segment from the input queues (see next_input()), choose the child it goes to and hand it to the worker that owns that child.
+         *
+         *  Taking and assigning happen under one lock, so the segments of each child reach its worker in input order, and the kill
+         *  messages to the children always land behind every segment that came before them.
+         *
+         *  @return True if a segment was taken (or the tree was ended); False if the input queues were empty.
+         */
+        
+        bool root_impl::dispatch(){
+            
+            // Real-time streams wait in deadline order, and are shed once they cannot make it. The gaps of the shed segments go to the
+            // output queues only after the lock is released: a full output queue must not hold up the other workers and the receivers
+            if(d_sample_rate > 0){
+                std::vector< std::vector<char>* > gaps;
+                bool progress;
+                {
+                    boost::mutex::scoped_lock lock(dispatch_lock);
+                    progress = schedule();
+                    gaps.swap(shed_gaps);
+                }
+                
+                for(size_t i = 0; i < gaps.size(); i++)
+                    deliver(gaps[i]);
+                
+                return progress;
+            }
+            
+            boost::mutex::scoped_lock lock(dispatch_lock);
+            
+            int stream;
+            std::vector<float> *temp = next_input(stream);
+            
+            if(temp == NULL)
+                return end_tree();
+            
+            int index = target(); // Grab index of next target
+            if(index < 0)
+                index = (d_run_left > 0) ? d_run_child : 0; // Backed up since the check in send(); the writer will catch up
+            
+            // A new run starts with the least loaded child, and keeps it for affinity_run segments
+            if(d_run_left == 0){
+                d_run_child = index;
+                d_run_left = d_affinity_run;
+            }
+            d_run_left--;
+            
+            assign(temp, index);
+            return true;
+        }
+        
+        /*!
+         *  Weighted fair queueing over the streams: returns the next data segment, from the stream whose segment would be done first in
+         *  virtual time. A stream's virtual time grows by the size of each of its segments divided by its weight, so while several
+         *  streams have segments waiting, the children's capacity is shared in proportion to their weights; a stream that was idle
+         *  starts again from the current virtual time, without credit for the time it was idle. Called with dispatch_lock held.
+         *
+         *  The segment gets a tree-wide index in place of its own, so results from every stream can share the children; the stream and
+         *  the old index are restored when the result comes back (see deliver()).
+         *
+         *  @param stream The stream the segment came from.
+         *  @return The segment; NULL if no stream has one ready.
+         */
+        
+        std::vector<float>* root_impl::next_input(int &stream){
+            
+            boost::mutex::scoped_lock lock(stream_lock);
+            
+            int chosen = -1;
+            double chosen_start = 0, chosen_finish = 0;
+            
+            for(int s = 0; s < (int)streams.size(); s++){
+                input_stream &st = streams[s];
+                std::vector<float> *temp;
+                
+                // Every stream keeps its next segment at hand, to compare
+                while(st.head == NULL && !st.killed && st.in_queue->pop(temp)){
+                    
+                    if(segment_traits<float>::is_kill(*temp)){
+                        st.killed = true;
+                        delete temp;
+                        close_stream(s); // Ends its output once its results are back
+                    }
+                    else if(!segment_traits<float>::is_data(*temp)){
+                        std::cout << "ERROR: Parent Router is trying to parse an incorrectly formatted packet" << std::endl;
+                        delete temp;
+                    }
+                    else{
+                        st.head = temp;
+                    }
+                }
+                
+                if(st.head == NULL)
+                    continue;
+                
+                double start = std::max(st.finish, d_virtual_time);
+                double finish = start + segment_traits<float>::size(*st.head) / st.weight;
+                
+                if(chosen < 0 || finish < chosen_finish){
+                    chosen = s;
+                    chosen_start = start;
+                    chosen_finish = finish;
+                }
+            }
+            
+            if(chosen < 0)
+                return NULL;
+            
+            input_stream &st = streams[chosen];
+            d_virtual_time = chosen_start;
+            st.finish = chosen_finish;
+            
+            std::vector<float> *temp = st.head;
+            st.head = NULL;
+            
+            // Swap in the tree-wide index (exact in a float up to 2^24)
+            segment_origin origin;
+            origin.stream = chosen;
+            origin.index = segment_traits<float>::index(*temp);
+            
+            int index = next_index;
+            next_index = (next_index + 1) % (1 << 24);
+            
+            origins[index] = origin;
+            (*temp)[1] = (float)index;
+            st.in_flight++;
+            
+            stream = chosen;
+            return temp;
+        }
+        
+        /*!
+         *  Once every stream has ended and nothing waits for a lane anymore, send the kill messages down the tree. Called with dispatch_lock held.
+         *
+         *  @return True if the tree was ended just now.
+         */
+        
+        bool root_impl::end_tree(){
+            
+            if(d_tree_ended || !waiting.empty())
+                return false;
+            
+            stream_lock.lock();
+            bool drained = true;
+            for(size_t s = 0; s < streams.size() && drained; s++)
+                drained = streams[s].killed && streams[s].head == NULL;
+            stream_lock.unlock();
+            
+            if(!drained)
+                return false;
+            
+            d_tree_ended = true;
+            
+            std::vector<float> *kill = new std::vector<float>();
+            segment_traits<float>::write_kill(*kill);
+            end_stream(kill);
+            return true;
+        }
+        
+        /*!
+         *  Hand a result (or a gap) to the output queue of its stream, with the index it had in the stream.
+         *
+         *  @param result The result segment, with its tree-wide index.
+         */
+        
+        void root_impl::deliver(std::vector<char> *result){
+            
+            int index = (int)segment_traits<char>::index(*result);
+            
+            stream_lock.lock();
+            std::map<int, segment_origin>::iterator it = origins.find(index);
+            if(it == origins.end()){
+                stream_lock.unlock();
+                std::cout << "ERROR: Dropping a result that belongs to no stream (index " << index << ")" << std::endl;
+                delete result;
+                return;
+            }
+            
+            int stream = it->second.stream;
+            float stream_index = it->second.index;
+            boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > *queue = streams[stream].out_queue;
+            origins.erase(it);
+            stream_lock.unlock();
+            
+            memcpy(&((*result)[1]), &stream_index, 4); // The header is in host order
+            
+            while(!queue->push(result))
+                boost::this_thread::sleep(boost::posix_time::microseconds(10));
+            
+            // Only now may the kill message of the stream follow
+            stream_lock.lock();
+            streams[stream].in_flight--;
+            close_stream(stream);
+            stream_lock.unlock();
+        }
+        
+        /*!
+         *  Push the kill message to the output queue of a stream once its own kill message came through and all of its results are out.
+         *  Called with stream_lock held.
+         *
+         *  @param stream The stream.
+         */
+        
+        void root_impl::close_stream(int stream){
+            
+            input_stream &st = streams[stream];
+            
+            if(!st.killed || st.in_flight > 0 || st.ended)
+                return;
+            
+            std::vector<char> *kill_msg = new std::vector<char>();
+            segment_traits<char>::write_kill(*kill_msg);
+            
+            if(VERBOSE)
+                myfile << "Pushing kill message of stream " << stream << std::endl;
+            
+            while(!st.out_queue->push(kill_msg))
+                boost::this_thread::sleep(boost::posix_time::microseconds(10));
+            
+            st.ended = true;
+        }
+        
+        /*!
+         *  Register another input/output queue pair with the root; its segments share the children with the other streams.
+         *
+         *  @param &input_queue The input queue of the stream.
+         *  @param &output_queue The output queue its results are pushed to.
+         *  @param weight The share of the children's capacity the stream gets while others are busy too, relative to the other weights.
+         *  @return The ID of the stream; -1 if the tree has already ended.
+         */
+        
+        int root_impl::add_stream(boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > &input_queue, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &output_queue, double weight){
+            
+            boost::mutex::scoped_lock dispatching(dispatch_lock);
+            boost::mutex::scoped_lock lock(stream_lock);
+            
+            if(d_tree_ended){
+                std::cout << "ERROR: Cannot add a stream to a root whose children have been sent the end of the stream" << std::endl;
+                return -1;
+            }
+            
+            streams.push_back(input_stream(&input_queue, &output_queue, weight));
+            return streams.size() - 1;
+        }
+        
+        /*!
+         *  Hand a data segment to the worker that owns its child (or to the local flow graph). Called with dispatch_lock held.
+         *
+         *  @param temp The segment.
+         *  @param index The lane it goes to.
+         */
+        
+        void root_impl::assign(std::vector<float> *temp, int index){
+            
+            int data_size = (int)temp->at(2); // The size of the data segment is located at index 2
+            d_total_samples += data_size;
+            
+            // Processed right here, by the local flow graph
+            if(index == local_lane){
+                local_outstanding.fetch_add(1, boost::memory_order_relaxed);
+                
+                while(!local_in->push(temp))
+                    boost::this_thread::sleep(boost::posix_time::microseconds(10));
+                return;
+            }
+            
+            weights[index].fetch_add(1, boost::memory_order_relaxed); // In segments, like the weight the child reports
+            increment(index); // Outstanding from here on, so the next choice already sees it
+            
+            send_item item;
+            item.child = index;
+            item.segment = temp;
+            
+            send_shard *shard = shards[index % send_workers];
+            shard->lock.lock();
+            shard->items.push_back(item);
+            shard->lock.unlock();
+            shard->ready.notify_one();
+        }
+        
+        /*!
+         *  The kill message came through the input queue: every lane gets one, behind the segments already assigned to it.
+         *  Called with dispatch_lock held.
+         *
+         *  @param temp The kill message.
+         */
+        
+        void root_impl::end_stream(std::vector<float> *temp){
+            
+            // Segments being stolen are still on their way to another child; they go ahead of its kill message
+            // (a victim whose link closes gives up its request; see steal_answered())
+            if(d_steal_depth > 0){
+                boost::unique_lock<boost::mutex> lock(steal_lock);
+                d_draining = true;
+                while(steals_pending > 0 && !d_finished)
+                    steal_done.timed_wait(lock, boost::posix_time::milliseconds(10)); // Wakes up now and then to notice stop()
+            }
+            
+            // Every child gets a kill message, behind the segments already assigned to it
+            send_item item;
+            for(int i = 0; i < number_of_children; i++){
+                item.child = i;
+                item.segment = NULL;
+                
+                send_shard *shard = shards[i % send_workers];
+                shard->lock.lock();
+                shard->items.push_back(item);
+                shard->lock.unlock();
+                shard->ready.notify_one();
+            }
+            
+            // The local flow graph ends behind its segments as well; its queue sink answers with a kill of its own
+            if(local_lane >= 0){
+                while(!local_in->push(temp))
+                    boost::this_thread::sleep(boost::posix_time::microseconds(10));
+                return;
+            }
+            
+            delete temp;
+        }
+        
+        /*!
+         *  Deadline scheduling: pull up to EDF_WINDOW segments from the input queue and give each one its deadline, drop the ones that
+         *  cannot meet theirs anymore, and assign the one with the earliest deadline to the lane that will finish it first. Called with
+         *  dispatch_lock held.
+         *
+         *  A segment is due latency seconds after its last sample was captured; with the samples of the stream arriving at sample_rate,
+         *  that is the number of items up to the end of the segment divided by the rate. A lane finishes a new segment once it has worked
+         *  through the segments it already has, at the pace its results have been coming back (see arrived()). The earliest deadline
+         *  waits while the lanes are busy; once no lane could finish it in time, it is shed, and a gap segment goes to the output queue
+         *  in its place, so the queue source downstream knows what is missing. Sticky runs do not apply here.
+         *
+         *  @return True if any segment was pulled, shed, or assigned.
+         */
+        
+        bool root_impl::schedule(){
+            
+            bool progress = false;
+            std::vector<float> *temp;
+            
+            // Waiting segments, earliest deadline first; within a stream the deadlines come in stream order
+            int stream;
+            while((int)waiting.size() < EDF_WINDOW && (temp = next_input(stream)) != NULL){
+                progress = true;
+                
+                input_stream &st = streams[stream]; // Only the dispatcher uses the clocks; the vector only grows under dispatch_lock
+                double seconds = (int)temp->at(2) / d_sample_rate; // Time it took to capture the segment
+                
+                // The clock of a stream starts with its first segment: its last sample has just come in
+                if(!st.clock_started){
+                    st.clock_start = boost::get_system_time() - boost::posix_time::microseconds((long)(seconds * 1e6));
+                    st.clock_started = true;
+                }
+                
+                st.clock_seconds += seconds;
                 
-                // If there is a window available, send it to indexed node
-                if(in_queue->pop(temp)){
+                timed_segment segment;
+                segment.deadline = st.clock_start + boost::posix_time::microseconds((long)((st.clock_seconds + d_latency) * 1e6));
+                segment.segment = temp;
+                waiting.insert(std::upper_bound(waiting.begin(), waiting.end(), segment, earlier_deadline), segment);
+            }
+            
+            while(!waiting.empty()){
+                
+                boost::system_time now = boost::get_system_time();
+                boost::system_time deadline = waiting.front().deadline;
+                
+                // The lane that would finish the segment first; -1 if none can take it now
+                int lane = -1;
+                bool in_time = false; // Some lane could still make the deadline, now or once it has room
+                boost::system_time first;
+                
+                flight_lock.lock();
+                for(int i = 0; i < number_of_lanes; i++){
+                    int load = (i == local_lane) ? local_outstanding.load(boost::memory_order_relaxed) : outstanding[i].load(boost::memory_order_relaxed);
                     
-                	int packet_type = (int)temp->at(0); // Get packet type
+                    // Until a lane has shown its pace, it only gets two segments at a time
+                    if(lane_period_us[i] <= 0 && load >= 2)
+                        continue;
                     
-                	if(VERBOSE)
-                        myfile << "Packet type: packet_type" << std::endl;
+                    boost::system_time done = now + boost::posix_time::microseconds((long)((load + 1) * lane_period_us[i]));
+                    if(done > deadline)
+                        continue;
                     
-                	// Switch on the packet_type
-                	switch(packet_type){
-                    	case 1:
-                    	{
-                        	index = min(); // Grab index of next target
-                            
-                        	data_size = (int)temp->at(2); // The size of the data segment is located at index 2
-                        	window_count = data_size / 768;
-                        	packet_size = (data_size + 3) * 4; // Size of the data + headers * 4 (chars per byte)
-                            
-                        	char* data_bytes = new char[packet_size];
-                            
-                        	weights[index] += window_count;
-                            
-                        	d_total_samples += data_size;
-                            
-                        	if(VERBOSE)
-                                myfile << "Sending packet index=" << temp->at(1) << " to child=" << index << std::endl;
-                            
-                        	memcpy(&(data_bytes[0]), &(temp->data()[0]), packet_size);
-                            
-                        	sent = 0;
-                        	while(sent < packet_size)
-                                sent += connector->send(index, &(data_bytes[sent]), (packet_size - sent));
-                            
-                        	if(VERBOSE)
-                                myfile << "Finished sending" << std::endl;
-                            
-                        	// We've sent the data, so don't need the memory anymore
-                        	delete[] data_bytes;
-                            
-                        	for(int i = 0; i < window_count; i++)
-                          		increment();
-                            
-                        	break;
-                    	}
-                    	case 3:
-                    	{
-                        	for(int i = 0; i < number_of_children; i++){
-                                sent = 0;
-                                while(sent < 1)
-                                    sent += connector->send(i, (char*)&((temp->data())[sent]), (1-sent)); // Send the segment
-                        	}
-                            
-                        	break;
-                        }
-                    	default:
-                        {
-                            std::cout << "ERROR: Parent Router is trying to parse an incorrectly formatted packet" << std::endl;
-                        	break;
-                   	    }
+                    in_time = true;
+                    
+                    if(lane_ready(i) && (lane < 0 || done < first)){
+                        lane = i;
+                        first = done;
                     }
                 }
-		        else{
-                    boost::this_thread::sleep(boost::posix_time::microseconds(1000));
-		        }
-                // Future Work: Include additonal code for redundancy; keep copy of window until it has been ACKd;; Is this required given we're using TCP?
+                flight_lock.unlock();
+                
+                if(!in_time){
+                    shed(waiting.front().segment);
+                    waiting.pop_front();
+                    progress = true;
+                    continue;
+                }
+                
+                if(lane < 0)
+                    break; // The earliest deadline waits for a lane
+                
+                timed_segment segment = waiting.front();
+                waiting.pop_front();
+                
+                flight_lock.lock();
+                flights[(int)segment.segment->at(1)] = segment.deadline;
+                flight_lock.unlock();
                 
+                assign(segment.segment, lane);
+                progress = true;
             }
             
+            // Everything ahead of the kill messages is gone
+            if(end_tree())
+                progress = true;
+            
+            return progress;
+        }
+        
+        /// Compare function used to keep the waiting segments sorted by deadline
+        bool root_impl::earlier_deadline(const timed_segment &a, const timed_segment &b){
+            return a.deadline < b.deadline;
+        }
+        
+        /*!
+         *  Drop a segment that cannot meet its deadline, and leave a gap segment with its index in its place; dispatch() pushes it to
+         *  the output queue once dispatch_lock is released. Called with dispatch_lock held.
+         *
+         *  @param temp The segment.
+         */
+        
+        void root_impl::shed(std::vector<float> *temp){
+            
+            std::vector<char> *gap = new std::vector<char>();
+            segment_traits<char>::write_gap(*gap, segment_traits<float>::index(*temp));
+            
+            if(VERBOSE)
+                myfile << "Shedding segment index=" << temp->at(1) << std::endl;
+            
             delete temp;
+            d_shed.fetch_add(1, boost::memory_order_relaxed);
+            
+            shed_gaps.push_back(gap);
+        }
+        
+        /*!
+         *  A result came back from a lane; count it if it came after its deadline, and keep track of the pace of the lane: the average
+         *  time between its results while it has work (an exponential moving average, 1/8 for the newest).
+         *
+         *  @param index The index of the result.
+         *  @param lane The lane it came from.
+         *  @param load The segments the lane still has, after this one.
+         */
+        
+        void root_impl::arrived(float index, int lane, int load){
+            
+            boost::system_time now = boost::get_system_time();
+            boost::mutex::scoped_lock lock(flight_lock);
+            
+            std::map<int, boost::system_time>::iterator it = flights.find((int)index);
+            if(it != flights.end()){
+                if(now > it->second)
+                    d_late.fetch_add(1, boost::memory_order_relaxed);
+                flights.erase(it);
+            }
+            
+            // Only the time between two results of a busy lane is its pace; an idle lane was waiting for work
+            if(lane_busy[lane]){
+                double period_us = (double)(now - lane_last_result[lane]).total_microseconds();
+                lane_period_us[lane] = (lane_period_us[lane] <= 0) ? period_us : lane_period_us[lane] + (period_us - lane_period_us[lane]) / 8;
+            }
+            
+            lane_last_result[lane] = now;
+            lane_busy[lane] = (load > 0);
+        }
+        
+        /*!
+         *  The number of segments shed so far because they could not meet their deadline.
+         */
+        
+        uint64_t root_impl::segments_shed(){
+            return d_shed.load(boost::memory_order_relaxed);
+        }
+        
+        /*!
+         *  The number of results that came back after their deadline so far.
+         */
+        
+        uint64_t root_impl::results_late(){
+            return d_late.load(boost::memory_order_relaxed);
+        }
+        
+        /*!
+         *  Send every segment that has been assigned to the children of a worker.
+         *
+         *  @param worker The index of the worker.
+         *  @return True if there was anything to send.
+         */
+        
+        bool root_impl::drain(int worker){
+            
+            send_shard *shard = shards[worker];
+            std::deque<send_item> items;
+            
+            shard->lock.lock();
+            items.swap(shard->items);
+            shard->lock.unlock();
+            
+            for(size_t i = 0; i < items.size(); i++)
+                send_segment(items[i]);
+            
+            return !items.empty();
+        }
+        
+        /*!
+         *  Encode one assigned segment with the codec its child accepted, and queue it on the child's link.
+         *
+         *  @param item The segment and the child it was assigned to; a NULL segment is a kill message.
+         */
+        
+        void root_impl::send_segment(const send_item &item){
+            
+            int index = item.child;
+            std::vector<float> *temp = item.segment;
+            
+            if(temp == NULL){
+                // The children read a whole three float header, even for a kill message
+                boost::shared_ptr< std::vector<char> > kill_msg(new std::vector<char>(3 * sizeof(float)));
+                put_float(&(*kill_msg)[0], 3);
+                put_float(&(*kill_msg)[4], 0);
+                put_float(&(*kill_msg)[8], 0);
+                
+                // Queued behind the segments already waiting for the child
+                connector->queue_frame(index, &(*kill_msg)[0], kill_msg->size(), checksums[index], kill_msg); // Send the kill message
+                return;
+            }
+            
+            int data_size = (int)temp->at(2); // The size of the data segment is located at index 2
+            int packet_size;
+            
+            if(VERBOSE)
+                myfile << "Sending packet index=" << temp->at(1) << " to child=" << index << std::endl;
+            
+            char* data_bytes; // The bytes that go on the wire
+            boost::shared_ptr<void> owner; // Whoever owns those bytes; released once the frame is written
+            
+            size_t table_size; // The tag table behind the data is already in wire order
+            const char *table = segment_tag_table(*temp, table_size);
+            
+            if(sample_codecs[index] == CODEC_NONE && !ROUTER_WIRE_SWAP){
+                data_bytes = (char*)temp->data(); // Host floats are already in wire order; send the segment as it is
+                packet_size = temp->size() * 4; // Size of the headers + data + tag table * 4 (chars per float)
+                owner = boost::shared_ptr< std::vector<float> >(temp);
+            }
+            else{
+                // Little-endian header, then the samples encoded with the codec the child accepted, then the tag table
+                std::vector<char> *encoded = new std::vector<char>(3 * sizeof(float));
+                encoded->reserve(3 * sizeof(float) + encoded_samples_size(sample_codecs[index], data_size) + table_size);
+                floats_to_wire(temp->data(), &(*encoded)[0], 3);
+                encode_samples(sample_codecs[index], &(temp->data()[3]), data_size, *encoded);
+                encoded->insert(encoded->end(), table, table + table_size);
+                
+                data_bytes = &(*encoded)[0];
+                packet_size = encoded->size();
+                owner = boost::shared_ptr< std::vector<char> >(encoded);
+                
+                delete temp; // We've encoded the data, so don't need the segment anymore
+            }
+            
+            // Never blocks; a slow child only backs up its own queue
+            connector->queue_frame(index, data_bytes, packet_size, checksums[index], owner);
+            
+            if(VERBOSE)
+                myfile << "Queued for sending" << std::endl;
         }
         
         /*
-         Format of type-2 Segments
+         Every message on a link travels in a frame; see NetworkInterface.cc for the frame format.
+         */
+        
+        /*
+         Format of type-3 Segments (results; all values little-endian; see wire_format.h)
          |
-         < type :: [0] > -- contains the message type
+         < type :: [0] > -- contains the message type ('3')
          < index :: [1,2,3,4] > -- contains the index of the window
          < size :: [5,6,7,8] > -- contains the size of the data in the data field to come next
-         < data :: [...] > -- contains data followed by zeros
-         < weight :: [1,2,3,4] > -- contains the weight of the sending child
+         < compressed size :: [9,10,11,12] > -- only with CODEC_LZ; the size of the compressed data field
+         < data :: [...] > -- contains data followed by zeros (compressed with CODEC_LZ); little-endian words of the size agreed in the codec negotiation
+         < weight :: [1,2,3,4] > -- contains the weight of the sending child: its outstanding segments
+         < tags :: [...] > -- the tag table of the result, if it carries stream tags (see tag_table.h)
+         
+         Type-1 segments on their way to the children carry their tag table the same way, right behind the samples.
+         */
+        
+        /*
+         Format of type-4 Segments
+         |
+         < type :: [0] > -- contains the message type ('4'; the child is done)
+         
+         End of stream: the kill message from the input queue is sent to every child behind its segments. A child
+         answers with a type-4 segment once it has sent all of its results, and once every child has answered, the
+         root pushes a kill message into the output queue.
          */
         
         /*
-         Format of type-3 Segments
+         Format of type-6 Segments (work stealing)
          |
-         < type :: [0] > -- contains the message type
+         root -> child: float < type :: [0] > = 6, float < count :: [1] >, float < unused :: [2] > -- give back up to count segments
+         child -> root: < type :: [0] > = '6', int32 < count :: [1,2,3,4] >, then count * { int32 < size >, < segment > }
+         
+         A given back segment is the type-1 segment as the child received it: the three float header, the samples as
+         floats, then its tag table (all little-endian). The child gives back the segments it holds back for its flow
+         graph, newest first, and answers every request, with a count of 0 if it has nothing left to give.
          */
         
         
@@ -298,13 +951,10 @@ namespace gr {
                 thread_file.open(name_buff);
             }
             
-            char * temp_buffer = new char[9];
-     	    std::vector<char> *temp;
-            int size = 0;
+            std::vector<char> frame; // Body of the current frame
             std::vector<char> *arrival;
-            std::vector<float> *kill_msg;
             
-            float weight;
+            connector->pin_receiver(index);
             
             if(VERBOSE)
                 std::cout << "Started receiver thread for child #" << index << std::endl;
@@ -312,24 +962,16 @@ namespace gr {
      	    // Until the thread is finished
      	    while(!d_finished){
                 
-                // Wait until there's something to receive (may want to replace with something more efficient than a spinning wait)
-                size = 0;
-                while(size < 9){
-                    size += connector->receive(index, (char*)&(temp_buffer[size]), (9-size)); // Grab first byte (type), float (index), float (size)
-                    if(size == 0 && d_finished)
-                        return; // We're done
-                }
-                
-                char packet_type = temp_buffer[0];
-                
-                float message_index;
-                memcpy(&message_index, &(temp_buffer[1]), 4);
+                int status = connector->receive_frame(index, frame, checksums[index]);
                 
-                float data_size;
-                memcpy(&data_size, &(temp_buffer[5]), 4);
+                if(status < 0){
+                    steal_answered(index); // The link was closed; a steal request to this child will not be answered
+                    return;
+                }
+                if(status == 0)
+                    continue; // A corrupted frame was dropped; the next one is intact again
                 
-                int number_of_windows = data_size / 768;
-                int remaining_message_size = data_size + (1 * sizeof(int)); // One footer at the end (the weight)
+                char packet_type = frame.at(0);
                 
                 switch(packet_type){
                     case '1':
@@ -344,60 +986,159 @@ namespace gr {
                     }
                     case '3':
                     {
-                        char * buffer = new char[remaining_message_size];
+                        if(frame.size() < 9){
+                            connector->count_malformed(index);
+                            break;
+                        }
+                        
+                        float message_index = get_float(&(frame[1]));
+                        float data_size = get_float(&(frame[5]));
                         
-                        size = 0;
-                        while(size < remaining_message_size)
-                            size += connector->receive(index, (char*)&(buffer[size]), (remaining_message_size-size)); // Receive the data
+                        // LZ compressed results carry the compressed size in front of the data
+                        int offset = 9;
+                        int data_bytes = 0;
+                        
+                        if(result_codecs[index] == CODEC_LZ && frame.size() >= 13){
+                            data_bytes = get_int32(&(frame[9]));
+                            offset = 13;
+                        }
+                        
+                        // Check the size before using it; an LZ sequence expands at most 255-fold
+                        float max_size = (offset == 13) ? 256.0f * (float)(frame.size() - offset) : (float)frame.size();
+                        if(!(data_size >= 0 && data_size <= max_size)){
+                            std::cout << "ERROR: Dropping a malformed result from child " << index << std::endl;
+                            connector->count_malformed(index);
+                            break;
+                        }
+                        if(offset == 9)
+                            data_bytes = (int)data_size;
+                        
+                        // The frame must hold the data and the weight; the tag table follows
+                        if(data_bytes < 0 || (int)frame.size() - offset - 4 < data_bytes){
+                            std::cout << "ERROR: Dropping a malformed result from child " << index << std::endl;
+                            connector->count_malformed(index);
+                            break;
+                        }
                         
-                        float weight;
-                        memcpy(&weight, &(buffer[remaining_message_size-4]), 4);
+                        float weight = get_float(&(frame[offset + data_bytes]));
+                        int table_start = offset + data_bytes + 4;
                         
                         arrival = new std::vector<char>();
-                        arrival->push_back('2'); // type 1 message
-                        arrival->insert(arrival->end(), &(temp_buffer[1]), &(temp_buffer[9])); // Insert index and data_size bytes
-                        arrival->insert(arrival->end(), &buffer[0], &buffer[(int)data_size]);
                         
-                        while(!out_queue->push(arrival))
-                            ;
+                        if(result_codecs[index] == CODEC_LZ){
+                            segment_traits<char>::write_header(*arrival, message_index, data_size); // type 2 segment with host order index and data_size
+                            arrival->resize(9 + (int)data_size);
+                            
+                            if(!lz_decompress(&(frame[offset]), data_bytes, &((*arrival)[9]), (int)data_size)){
+                                std::cout << "ERROR: Could not decompress the result from child " << index << std::endl;
+                                connector->count_malformed(index);
+                                delete arrival;
+                                break;
+                            }
+                            words_wire_order(&((*arrival)[9]), (int)data_size, d_result_word_size);
+                            
+                            arrival->insert(arrival->end(), frame.begin() + table_start, frame.end());
+                        }
+                        else{
+                            // The frame already holds the data where the segment has it; turn the frame itself into the segment, without copying the data
+                            words_wire_order(&(frame[offset]), data_bytes, d_result_word_size);
+                            
+                            std::vector<char> header;
+                            segment_traits<char>::write_header(header, message_index, data_size);
+                            std::copy(header.begin(), header.end(), frame.begin());
+                            
+                            // Close the hole of the weight in front of the tag table
+                            std::copy(frame.begin() + table_start, frame.end(), frame.begin() + table_start - 4);
+                            frame.resize(frame.size() - 4);
+                            
+                            arrival->swap(frame); // The next frame is read into a new buffer
+                        }
                         
-                        for(int i = 0; i < number_of_windows; i++)
-                            decrement();
+                        decrement(index);
                         
-                        weights[index] = weight;
-                        delete[] buffer;
+                        weights[index].store((int)weight, boost::memory_order_relaxed);
+                        
+                        if(d_sample_rate > 0)
+                            arrived(message_index, index, outstanding[index].load(boost::memory_order_relaxed));
+                        
+                        deliver(arrival);
+                        
+                        if(d_steal_depth > 0)
+                            steal_for(index);
                         break;
                     }
                     case '4':
                     {
-                        /*
-                         killed_lock.lock();
-                         num_killed++;
-                         killed_lock.unlock();
-                         
-                         if(num_killed == number_of_children){
-                         kill_msg = new std::vector<char>();
-                         kill_msg->push_back('3');
-                         if(VERBOSE)
-                         thread_file << "Pushing kill message" << std::endl;
-                         
-                         while(!out_queue->push(kill_msg))
-                         ;
-                         }
-                         return;
-                         */
+                        // The child has sent all of its results
+                        finish_lane();
+                        return; // Nothing else comes from this child
+                    }
+                    case '6':
+                    {
+                        // Segments taken back from this child, for a child that ran out of work
+                        take_back(index, frame);
                         break;
                     }
                     default:
                     {
                         std::cout << "ERROR: Receiving unacceptable image format" << std::endl;
+                        connector->count_malformed(index);
                         break;
                     }
                 }
                 
             }
+        }
+        
+        /*
+         Format of type-5 Segments (codec negotiation)
+         |
+         root -> child: float < type :: [0] > = 5, float < sample codec :: [1] >, float < result codec :: [2] >, float < checksum :: [3] > (little-endian)
+                        , float < steal depth :: [4] > -- 0 without work stealing
+                        , float < result word size :: [5] > -- bytes per word of the result data: 1, 2 or 4
+         child -> root: < type :: [0] > = '5', float < sample codec :: [1,2,3,4] >, float < result codec :: [5,6,7,8] >, float < checksum :: [9,10,11,12] >
+                        [, float < steal depth :: [13,14,15,16] >] -- only in answer to a steal depth; 0 if the child does not take part
+         
+         Once checksums are agreed, every later frame in either direction ends with a CRC32C trailer.
+         */
+        
+        /*!
+         *  Propose the wire codecs to the child at index, and record the codecs that the child accepted.
+         *
+         *  @param index The index of the child to negotiate with.
+         */
+        
+        void root_impl::negotiate(int index){
+            
+            char hello[6 * sizeof(float)];
+            put_float(&hello[0], 5);
+            put_float(&hello[4], (float)d_sample_codec);
+            put_float(&hello[8], (float)d_result_codec);
+            put_float(&hello[12], d_checksum ? 1 : 0);
+            put_float(&hello[16], (float)d_steal_depth);
+            put_float(&hello[20], (float)d_result_word_size);
+            
+            connector->send_frame(index, hello, sizeof(hello), false);
+            
+            // Fall back to raw segments if the child did not accept
+            sample_codecs[index] = CODEC_NONE;
+            result_codecs[index] = CODEC_NONE;
+            checksums[index] = false;
+            steals[index] = false;
+            
+            std::vector<char> reply;
+            if(connector->receive_frame(index, reply, false) == 1 && (reply.size() == 13 || reply.size() == 17) && reply[0] == '5'){
+                sample_codecs[index] = (int)get_float(&(reply[1]));
+                result_codecs[index] = (int)get_float(&(reply[5]));
+                checksums[index] = d_checksum && (get_float(&(reply[9])) != 0);
+                steals[index] = d_steal_depth > 0 && reply.size() == 17 && (get_float(&(reply[13])) > 0);
+            }
+            else{
+                std::cout << "ERROR: Child " << index << " did not answer the codec proposal" << std::endl;
+            }
             
-            delete [] temp_buffer; // We're done with our buffer
+            if(VERBOSE)
+                std::cout << "Child " << index << " accepted sample codec " << sample_codecs[index] << " and result codec " << result_codecs[index] << std::endl;
         }
         
     	// Find index of child with minimum weight BIG_OH(N)
@@ -405,17 +1146,20 @@ namespace gr {
     	// Needs to become Configurable based on application (include XML for this)
         
         /*!
-         *	Returns the index of the child node with the minimum weight.
+         *	Returns the index of the child node with the minimum weight. Children whose outbound queue is backed up are skipped.
          *
-         *  @return index The index of the child with the lowest weight.
+         *  @return index The index of the child with the lowest weight; -1 if every child is backed up.
          */
         
         int root_impl::min(){
-            float min = weights[0];
-            int index = 0;
-            for(int i = 1; i < number_of_children; i++){
-                if(weights[i] < min){
-                    min = weights[i];
+            int min = 0;
+            int index = -1;
+            for(int i = 0; i < number_of_children; i++){
+                if(connector->queued_bytes(i) >= MAX_QUEUED_BYTES)
+                    continue;
+                int weight = weights[i].load(boost::memory_order_relaxed);
+                if(index < 0 || weight < min){
+                    min = weight;
                     index = i;
                 }
             }
@@ -423,23 +1167,261 @@ namespace gr {
         }
         
         /*!
-         *  Decrement the global segment counter.
+         *	Returns the lane the next segment goes to: the lane of the current run while the run lasts, else the least loaded child.
+         *  A run is not broken when its lane backs up; the segment waits for it, so a stateful child sees its stretch of the stream whole.
+         *  Once every child has local_threshold segments outstanding, the local lane takes the segment if it has room.
+         *  Called with dispatch_lock held, since the run moves on as segments are dispatched.
+         *
+         *  @return index The index of the child (local_lane for the local flow graph); -1 if the segment has to wait.
+         */
+        
+        int root_impl::target(){
+            if(d_run_left > 0)
+                return lane_ready(d_run_child) ? d_run_child : -1;
+            
+            if(local_lane >= 0 && lane_ready(local_lane)){
+                bool saturated = true;
+                for(int i = 0; i < number_of_children && saturated; i++)
+                    saturated = !lane_ready(i) || outstanding[i].load(boost::memory_order_relaxed) >= d_local_threshold;
+                
+                if(saturated)
+                    return local_lane;
+            }
+            
+            return min();
+        }
+        
+        /*!
+         *	Returns true if the lane can take another segment: a child whose outbound queue is not backed up, or a local lane with room.
+         */
+        
+        bool root_impl::lane_ready(int lane){
+            if(lane == local_lane)
+                return local_outstanding.load(boost::memory_order_relaxed) < d_local_threshold;
+            return connector->queued_bytes(lane) < MAX_QUEUED_BYTES;
+        }
+        
+        /*!
+         *	Local lane receiver: merge the results of the local flow graph into the output queue, as the receivers of the children do.
+         */
+        
+        void root_impl::receive_local(){
+            
+            std::vector<char> *result;
+            
+            while(!d_finished){
+                
+                if(!local_out->pop(result)){
+                    boost::this_thread::sleep(boost::posix_time::microseconds(100));
+                    continue;
+                }
+                
+                // The local flow graph has ended
+                if(segment_traits<char>::is_kill(*result)){
+                    delete result;
+                    finish_lane();
+                    return;
+                }
+                
+                if(!segment_traits<char>::is_data(*result)){
+                    std::cout << "ERROR: The local lane sent a segment of unexpected type" << std::endl;
+                    delete result;
+                    continue;
+                }
+                
+                local_outstanding.fetch_sub(1, boost::memory_order_relaxed);
+                
+                if(d_sample_rate > 0)
+                    arrived(segment_traits<char>::index(*result), local_lane, local_outstanding.load(boost::memory_order_relaxed));
+                
+                deliver(result);
+            }
+        }
+        
+        /*!
+         *	A lane (a child, or the local flow graph) has sent all of its results. Once the last one has, nothing else comes back;
+         *  a stream still waiting for a result that was lost ends here.
+         */
+        
+        void root_impl::finish_lane(){
+            
+            killed_lock.lock();
+            bool last = (++num_killed == number_of_lanes);
+            killed_lock.unlock();
+            
+            if(last){
+                boost::mutex::scoped_lock lock(stream_lock);
+                
+                for(int s = 0; s < (int)streams.size(); s++){
+                    if(streams[s].in_flight > 0)
+                        std::cout << "ERROR: Stream " << s << " ends without " << streams[s].in_flight << " of its results" << std::endl;
+                    
+                    streams[s].killed = true;
+                    streams[s].in_flight = 0;
+                    close_stream(s);
+                }
+            }
+        }
+        
+        /*!
+         *	The child at index has nothing outstanding anymore. If another child has a backlog, ask it to give half of it back
+         *  for this child. Only one request per child is answered at a time, and none once the end of the stream is on its way.
+         *
+         *  @param index The index of the idle child.
+         */
+        
+        void root_impl::steal_for(int index){
+            
+            if(!steals[index] || outstanding[index].load(boost::memory_order_relaxed) > 0)
+                return;
+            
+            boost::mutex::scoped_lock lock(steal_lock);
+            
+            if(d_draining || d_finished)
+                return;
+            
+            int victim = -1;
+            int most = 1; // A child with a single segment has nothing to give
+            
+            for(int i = 0; i < number_of_children; i++){
+                if(steal_thief[i] == index)
+                    return; // Segments are already on their way to this child
+                if(i == index || !steals[i] || steal_thief[i] >= 0)
+                    continue;
+                
+                int load = outstanding[i].load(boost::memory_order_relaxed);
+                if(load > most){
+                    most = load;
+                    victim = i;
+                }
+            }
+            
+            if(victim < 0)
+                return;
+            
+            steal_thief[victim] = index;
+            steals_pending++;
+            
+            boost::shared_ptr< std::vector<char> > steal_msg(new std::vector<char>(3 * sizeof(float)));
+            put_float(&(*steal_msg)[0], 6);
+            put_float(&(*steal_msg)[4], (float)(most / 2));
+            put_float(&(*steal_msg)[8], 0);
+            
+            connector->queue_frame(victim, &(*steal_msg)[0], steal_msg->size(), checksums[victim], steal_msg);
+            
+            if(VERBOSE)
+                myfile << "Child " << index << " steals up to " << most / 2 << " segments from child " << victim << std::endl;
+        }
+        
+        /*!
+         *	The child at index gave segments back. Rebuild them and hand them to the child they were stolen for; their index
+         *  is unchanged, so their results are merged like any other.
+         *
+         *  @param index The index of the child that gave the segments back.
+         *  @param frame The type-6 message.
+         */
+        
+        void root_impl::take_back(int index, const std::vector<char> &frame){
+            
+            steal_lock.lock();
+            int thief = steal_thief[index];
+            steal_lock.unlock();
+            
+            if(thief < 0)
+                thief = index; // Nobody asked; the segments go back where they came from
+            
+            int count = (frame.size() >= 5) ? get_int32(&(frame[1])) : 0;
+            size_t at = 5;
+            
+            for(int i = 0; i < count; i++){
+                
+                int size = (frame.size() - at >= 4) ? get_int32(&(frame[at])) : -1;
+                at += 4;
+                
+                if(size < (int)(3 * sizeof(float)) || (int)(frame.size() - at) < size){
+                    std::cout << "ERROR: Dropping malformed segments given back by child " << index << std::endl;
+                    connector->count_malformed(index);
+                    break;
+                }
+                
+                float header[3];
+                floats_from_wire(&(frame[at]), header, 3);
+                
+                // Check the size against the frame before using it
+                if(!(header[2] >= 0 && header[2] <= (size - 3 * (int)sizeof(float)) / (int)sizeof(float))){
+                    std::cout << "ERROR: Dropping malformed segments given back by child " << index << std::endl;
+                    connector->count_malformed(index);
+                    break;
+                }
+                int data_size = (int)header[2];
+                
+                if(3 * (int)sizeof(float) + data_size * (int)sizeof(float) > size){
+                    std::cout << "ERROR: Dropping malformed segments given back by child " << index << std::endl;
+                    connector->count_malformed(index);
+                    break;
+                }
+                
+                std::vector<float> *segment = new std::vector<float>(header, header + 3);
+                segment->resize(3 + data_size);
+                if(data_size > 0)
+                    floats_from_wire(&(frame[at + 12]), &((*segment)[3]), data_size);
+                
+                append_tag_table(*segment, std::vector<char>(frame.begin() + at + 12 + data_size * sizeof(float), frame.begin() + at + size));
+                at += size;
+                
+                // The segment is no longer outstanding at the child that gave it back
+                decrement(index);
+                increment(thief);
+                weights[index].fetch_sub(1, boost::memory_order_relaxed);
+                weights[thief].fetch_add(1, boost::memory_order_relaxed);
+                
+                send_item item;
+                item.child = thief;
+                item.segment = segment;
+                
+                send_shard *shard = shards[thief % send_workers];
+                shard->lock.lock();
+                shard->items.push_back(item);
+                shard->lock.unlock();
+                shard->ready.notify_one();
+            }
+            
+            // Only now may the kill message follow the segments
+            steal_answered(index);
+        }
+        
+        /*!
+         *	The steal request to the child at index was answered, or its link was closed and it never will be. Either way,
+         *  the child can be stolen from again, and the kill messages no longer wait for it.
+         *
+         *  @param index The index of the child that was asked to give segments back.
+         */
+        
+        void root_impl::steal_answered(int index){
+            
+            boost::mutex::scoped_lock lock(steal_lock);
+            
+            if(steal_thief[index] >= 0){
+                steal_thief[index] = -1;
+                steals_pending--;
+                steal_done.notify_all();
+            }
+        }
+        
+        /*!
+         *  One result came back from a child. Lock-free.
          */
         
-		void root_impl::decrement(){
-			global_lock.lock();
-			global_counter--;
-			global_lock.unlock();
+		void root_impl::decrement(int index){
+			outstanding[index].fetch_sub(1, boost::memory_order_relaxed);
 		}
         
         /*!
-         *	Increment the global segment counter.
+         *	One more segment was assigned to a child. Lock-free.
          */
         
-		void root_impl::increment(){
-			global_lock.lock();
-			global_counter++;
-			global_lock.unlock();
+		void root_impl::increment(int index){
+			outstanding[index].fetch_add(1, boost::memory_order_relaxed);
 		}
     } /* namespace router */
 } /* namespace gr */
@@ -21,11 +21,15 @@
 #define INCLUDED_ROUTER_ROOT_IMPL_H
 
 #include "NetworkInterface.h"
+#include "codec.h"
 #include <router/root.h>
 #include <memory>
 #include <boost/lockfree/queue.hpp>
 #include <boost/thread.hpp>
+#include <boost/atomic.hpp>
 #include <vector>
+#include <deque>
+#include <map>
 #include <fstream>
 
 
@@ -51,60 +55,225 @@ namespace gr {
  			int num_killed;
  			boost::mutex killed_lock;
             
- 			bool d_finished; // variable for destruction (kill threads)
+ 			boost::atomic<bool> d_finished; // variable for destruction (kill threads); polled by the sender, receiver and local lane threads
             
-			// Shared pointer to queues (input, output) and counters (implemented later)
- 			boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > *in_queue;
- 			float in_queue_counter;
+			// A stream: an input queue and the output queue its results go to (stream 0 is the pair given to make())
+ 			struct input_stream {
+ 				boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > *in_queue;
+ 				boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > *out_queue;
+ 				double weight; // Share of the children's capacity
+ 				std::vector<float> *head; // The next segment of the stream, popped to compare
+ 				double finish; // Virtual time at which its last segment taken is done
+ 				bool killed; // Its kill message came through
+ 				bool ended; // Its kill message was pushed to its output queue
+ 				int in_flight; // Segments taken whose results have not been pushed yet
+ 				
+ 				// Deadlines are measured from when the first sample of the stream was captured
+ 				bool clock_started;
+ 				boost::system_time clock_start;
+ 				double clock_seconds; // Stream time up to the end of the last segment taken
+ 				
+ 				input_stream(boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > *in, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > *out, double w)
+ 				: in_queue(in), out_queue(out), weight(w > 0 ? w : 1), head(NULL), finish(0), killed(false), ended(false), in_flight(0), clock_started(false), clock_seconds(0) {}
+ 			};
+ 			std::vector<input_stream> streams;
+ 			boost::mutex stream_lock;
+ 			double d_virtual_time; // Weighted fair queueing: virtual start time of the last segment taken
             
- 			boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > *out_queue;
- 			float out_queue_counter;
+			// Segments of every stream get a tree-wide index; the stream and index each one had
+ 			struct segment_origin {
+ 				int stream;
+ 				float index;
+ 			};
+ 			std::map<int, segment_origin> origins;
+ 			int next_index;
+ 			bool d_tree_ended; // The kill messages went down the tree
             
- 			int global_counter;
- 			boost::mutex global_lock;
+			// Segments assigned to each child whose results have not come back yet
+ 			boost::atomic<int> * outstanding;
             
  			boost::mutex file_lock;
             
  			boost::mutex out_queue_lock;
             
-			// Vector to send
- 			boost::shared_ptr< boost::thread > send_thread;
+			// A segment that has been assigned to a child, waiting for the worker that owns the child (NULL segment = kill)
+ 			struct send_item {
+ 				int child;
+ 				std::vector<float> *segment;
+ 			};
+            
+			// The segments assigned to the children of one sender worker
+ 			struct send_shard {
+ 				std::deque<send_item> items;
+ 				boost::mutex lock;
+ 				boost::condition_variable ready;
+ 			};
+            
+			// Sender workers; worker w owns every child i with i % send_workers == w
+ 			int send_workers;
+ 			std::vector<boost::shared_ptr< boost::thread > > send_threads;
+ 			std::vector<send_shard*> shards;
+            
+			// Serializes popping the input queue with the choice of child, so that choice stays global
+ 			boost::mutex dispatch_lock;
+            
+			// Sticky routing: runs of affinity_run consecutive segments go to the same child
+ 			int d_affinity_run;
+ 			int d_run_child; // Child of the current run
+ 			int d_run_left; // Segments left in the current run
             
 			// Vector of threads (for receiving)
  			std::vector<boost::shared_ptr< boost::thread > > thread_vector;
             
-			// Weights for each child
- 			float * weights;
+			// Local lane: a flow graph on the root that takes segments once every child is loaded (lane number_of_children)
+ 			boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > *local_in;
+ 			boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > *local_out;
+ 			int local_lane; // -1 without a local lane
+ 			int number_of_lanes; // Children, plus the local lane
+ 			int d_local_threshold;
+ 			boost::atomic<int> local_outstanding; // Segments in the local lane
+ 			boost::shared_ptr< boost::thread > local_thread;
+            
+			// Work stealing: a child that runs out of work takes segments the busiest child holds back
+ 			int d_steal_depth; // 0 without stealing
+ 			bool * steals; // Children that accepted stealing
+ 			int * steal_thief; // For each child being stolen from, the child its segments go to (-1 for none)
+ 			boost::mutex steal_lock;
+ 			boost::condition_variable steal_done; // Signalled whenever a steal request is answered or given up
+ 			bool d_draining; // The kill message is on its way; no more steals
+ 			int steals_pending; // Steal requests not answered yet
+            
+			// Deadlines: segments wait in deadline order, and the ones that cannot meet their deadline are shed
+ 			double d_sample_rate; // Floats of the input captured per second; 0 without deadlines
+ 			double d_latency; // Seconds a result may take after the end of its segment was captured
+ 			struct timed_segment {
+ 				boost::system_time deadline;
+ 				std::vector<float> *segment;
+ 			};
+ 			std::deque<timed_segment> waiting; // Taken from the input queues, earliest deadline first
+ 			std::vector< std::vector<char>* > shed_gaps; // Gaps of the segments shed, delivered once dispatch_lock is released
+            
+			// Deadlines of the segments on their way through a lane, by index
+ 			std::map<int, boost::system_time> flights;
+ 			boost::mutex flight_lock;
+            
+			// The pace of each lane: the average time between its results while it has work (0 until known)
+ 			std::vector<double> lane_period_us;
+ 			std::vector<boost::system_time> lane_last_result;
+ 			std::vector<bool> lane_busy;
+            
+ 			boost::atomic<uint64_t> d_shed; // Segments shed
+ 			boost::atomic<uint64_t> d_late; // Results that came back after their deadline
+            
+			// Weights for each child: its outstanding segments, as last reported (counted up as segments are assigned, and moved by steals);
+			// the dispatcher, the receivers and the steal hand-over all update them
+ 			boost::atomic<int> * weights;
             
 			// Connector used for networking between nodes
  			NetworkInterface *connector;
             
+			// Codecs proposed to the children, and the codecs each child accepted
+ 			int d_sample_codec, d_result_codec;
+ 			int * sample_codecs;
+ 			int * result_codecs;
+ 			int d_result_word_size; // Bytes per word of the result data; the words are converted from the wire order
+            
+			// CRC32C trailers on the links (proposed, and accepted per child)
+ 			bool d_checksum;
+ 			bool * checksums;
+            
  			// Keep track of floats and count for window segments
  			int total_floats, number_of_windows, left_over_values;
             
 			// window buffer (used for sending/receiving between children)
  			std::vector<float> window;
             
-			// Thread program for sending messages to children
- 			void send();
+			// Thread program for each sender worker
+ 			void send(int worker);
+            
+			// Take one segment from the input queues and assign it to a child; false if they were empty
+ 			bool dispatch();
+            
+			// The next segment of the streams in weighted fair order, with a tree-wide index; NULL if none is ready (dispatch_lock held)
+ 			std::vector<float>* next_input(int &stream);
+            
+			// Send the kill messages down the tree once every stream has ended; true if it did (dispatch_lock held)
+ 			bool end_tree();
+            
+			// Push a result or gap to the output queue of its stream, with its own index
+ 			void deliver(std::vector<char> *result);
+            
+			// Push the kill message of a stream once all of its results are out (stream_lock held)
+ 			void close_stream(int stream);
+            
+			// Assign a data segment to a lane / end the stream on every lane (dispatch_lock held)
+ 			void assign(std::vector<float> *temp, int index);
+ 			void end_stream(std::vector<float> *temp);
+            
+			// Deadline scheduling in place of dispatch(); false if nothing happened
+ 			bool schedule();
+            
+			// Compare function used to keep the waiting segments sorted by deadline
+ 			static bool earlier_deadline(const timed_segment &a, const timed_segment &b);
+            
+			// Drop a segment that cannot meet its deadline, leaving a gap in the output (dispatch_lock held)
+ 			void shed(std::vector<float> *temp);
+            
+			// Account for a result with a deadline from a lane that still has load segments
+ 			void arrived(float index, int lane, int load);
+            
+			// Encode and queue the segments assigned to the children of a worker; false if there were none
+ 			bool drain(int worker);
+            
+			// Queue one assigned segment on its child's link
+ 			void send_segment(const send_item &item);
             
 			// Thread program for receiving for each index
  			void receive(int index);
             
+			// Agree on the wire codecs with the child at index
+ 			void negotiate(int index);
+
+            
 			// Determine index of min child
  			int min();
             
+			// Child the next segment goes to; -1 if it has to wait (dispatch_lock held)
+ 			int target();
+            
+			// Can this lane (child or local) take another segment now?
+ 			bool lane_ready(int lane);
+            
+			// Thread program that merges the results of the local lane
+ 			void receive_local();
+            
+			// A lane has sent all of its results; the last one ends the output stream
+ 			void finish_lane();
+            
+			// The child at index ran out of work; ask the busiest child to give up some of its segments
+ 			void steal_for(int index);
+            
+			// The child at index gave segments back (a type-6 message); hand them to the child that asked for them
+ 			void take_back(int index, const std::vector<char> &frame);
+            
+			// The steal request to the child at index was answered, or will never be
+ 			void steal_answered(int index);
+            
 			// Compare function for SORT (may need to update to heap for speed)
  			bool compare_by_index(const std::vector<float> &a, const std::vector<float> &b);
             
-			// Global counter increment/decrement functions
- 			void increment();
- 			void decrement();
+			// Count a segment sent to / a result received from the child at index
+ 			void increment(int index);
+ 			void decrement(int index);
             
  		public:
- 			root_impl(int number_of_children, boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > &in_queue, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &out_queue, double throughput);
+ 			root_impl(int number_of_children, boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > &in_queue, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &out_queue, double throughput, int sample_codec, int result_codec, bool checksum, int send_workers, const connection_options &options, const scheduler_options &scheduling);
  			~root_impl();
             
+ 			int add_stream(boost::lockfree::queue< std::vector<float>*, boost::lockfree::fixed_sized<true> > &in_queue, boost::lockfree::queue< std::vector<char>*, boost::lockfree::fixed_sized<true> > &out_queue, double weight);
+ 			uint64_t segments_shed();
+ 			uint64_t results_late();
+            
       		// Where all the action really happens
  			int work(int noutput_items, 
                      gr_vector_const_void_star &input_items,
@@ -0,0 +1,166 @@
+/* -*- c++ -*- */
+/*
+ * Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ Segments are pushed through the shared queues as vectors of a storage type S.
+ Two storage types are supported, and each one has its own header format:
+
+ Format of float segments (type-1)
+ |
+ float < type :: [0] > -- contains the message type (1 = data, 3 = kill; the end of the stream, 4 = gap; a segment that was shed)
+ float < index :: [1] > -- contains the index of the window
+ float < size :: [2] > -- contains the size of the data field in floats
+ float < data :: [3, ...] > -- contains the data
+ |
+
+ Format of byte segments (type-2)
+ |
+ byte < type :: [0] > -- contains the message type ('2' = data, '3' = kill; the end of the stream, '4' = gap; a segment that was shed)
+ byte * 4 (float) < index :: [1,2,3,4] > -- contains the index of the window
+ byte * 4 (float) < size :: [5,6,7,8] > -- contains the size of the data field in bytes
+ byte < data :: [9, ...] > -- contains the data
+ |
+
+ Samples of any type T can be packed into either storage type; the data field is
+ simply the raw bytes of the samples. The size field counts whole storage items, so an
+ overlap is rounded up to whole storage items (see aligned_overlap()); otherwise the
+ padding of the last item would come out as extra samples.
+
+ A segment that carries stream tags other than the index has a tag table right behind
+ its data field; see tag_table.h.
+
+ A gap segment stands in for a segment that missed its deadline and was dropped; it has
+ the index of that segment and an empty data field.
+ */
+
+#ifndef INCLUDED_ROUTER_SEGMENT_TRAITS_H
+#define INCLUDED_ROUTER_SEGMENT_TRAITS_H
+
+#include <vector>
+#include <string.h>
+
+namespace gr {
+    namespace router {
+
+        template <class S> struct segment_traits;
+
+        /// Float segments; these are the segments the root router sends to its children
+        template <> struct segment_traits<float>
+        {
+            enum { header_items = 3, window_items = 768 };
+
+            static void write_header(std::vector<float> &segment, float index, float size){
+                segment.push_back(1);
+                segment.push_back(index);
+                segment.push_back(size);
+            }
+
+            static void write_kill(std::vector<float> &segment){ segment.push_back(3); }
+
+            static void write_gap(std::vector<float> &segment, float index){
+                segment.push_back(4);
+                segment.push_back(index);
+                segment.push_back(0);
+            }
+
+            static bool is_data(const std::vector<float> &segment){ return (int)segment.at(0) == 1; }
+            static bool is_kill(const std::vector<float> &segment){ return (int)segment.at(0) == 3; }
+            static bool is_gap(const std::vector<float> &segment){ return (int)segment.at(0) == 4; }
+            static float index(const std::vector<float> &segment){ return segment.at(1); }
+            static float size(const std::vector<float> &segment){ return segment.at(2); }
+        };
+
+        /// Byte segments; these are the segments the child routers send back to the root
+        template <> struct segment_traits<char>
+        {
+            enum { header_items = 9, window_items = 50 };
+
+            static void write_header(std::vector<char> &segment, float index, float size){
+                char bytes[8];
+                memcpy(&bytes[0], &index, 4);
+                memcpy(&bytes[4], &size, 4);
+
+                segment.push_back('2');
+                segment.insert(segment.end(), &bytes[0], &bytes[8]);
+            }
+
+            static void write_kill(std::vector<char> &segment){ segment.push_back('3'); }
+
+            static void write_gap(std::vector<char> &segment, float index){
+                write_header(segment, index, 0);
+                segment[0] = '4';
+            }
+
+            static bool is_data(const std::vector<char> &segment){ return segment.at(0) == '2'; }
+            static bool is_kill(const std::vector<char> &segment){ return segment.at(0) == '3'; }
+            static bool is_gap(const std::vector<char> &segment){ return segment.at(0) == '4'; }
+
+            static float index(const std::vector<char> &segment){
+                float value;
+                memcpy(&value, &(segment.at(1)), 4);
+                return value;
+            }
+
+            static float size(const std::vector<char> &segment){
+                float value;
+                memcpy(&value, &(segment.at(5)), 4);
+                return value;
+            }
+        };
+
+        /// An overlap of samples of type T, rounded up so that it fills whole storage items of type S
+        template <class T, class S>
+        int aligned_overlap(int overlap)
+        {
+            if(overlap <= 0)
+                return 0;
+
+            int a = sizeof(T), b = sizeof(S);
+            while(b != 0){
+                int r = a % b;
+                a = b;
+                b = r;
+            }
+
+            int step = sizeof(S) / a; // Samples per whole number of storage items
+            return ((overlap + step - 1) / step) * step;
+        }
+
+        /// The fewest samples of type T that fill a whole number of windows of storage type S: the least common multiple of the
+        /// window and the sample size, in samples (a 50 byte window holds 25 complex samples per 4 windows, not 6 per window)
+        template <class T, class S>
+        int window_multiple()
+        {
+            int window = segment_traits<S>::window_items * sizeof(S);
+
+            int a = window, b = sizeof(T);
+            while(b != 0){
+                int r = a % b;
+                a = b;
+                b = r;
+            }
+
+            return window / a;
+        }
+
+    } // namespace router
+} // namespace gr
+
+#endif /* INCLUDED_ROUTER_SEGMENT_TRAITS_H */
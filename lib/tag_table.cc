@@ -0,0 +1,198 @@
+/* -*- c++ -*- */
+/*
+ *  Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ See tag_table.h for the format of the tag tables.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "tag_table.h"
+#include "wire_format.h"
+#include <iostream>
+
+namespace gr {
+    namespace router {
+
+        /// Append a 32-bit int in wire order
+        static void append_int32(std::vector<char> &out, int32_t value){
+            size_t at = out.size();
+            out.resize(at + 4);
+            put_int32(&out[at], value);
+        }
+
+        tag_table::tag_table()
+        : d_index_key(pmt::string_to_symbol("i")), d_gap_key(pmt::string_to_symbol("gap"))
+        {
+        }
+
+        /*!
+         *  Returns the key with this name; looked up once per block.
+         */
+
+        pmt::pmt_t tag_table::intern(const std::string &name){
+            std::map<std::string, pmt::pmt_t>::iterator it = d_keys.find(name);
+            if(it != d_keys.end())
+                return it->second;
+
+            pmt::pmt_t key = pmt::string_to_symbol(name);
+            d_keys[name] = key;
+            return key;
+        }
+
+        /*!
+         *  Serialize the tags of samples [first, first + count) into a tag table.
+         *
+         *  @param tags The tags, as returned by get_tags_in_range(); the index tags are left out.
+         *  @param first The absolute offset of the first sample of the data field that is new.
+         *  @param count The number of new samples.
+         *  @param item_size The size of a sample in bytes.
+         *  @param lead_bytes Bytes in front of the new samples in the data field (the overlap history).
+         *  @param out The table; left empty if there is no tag to carry.
+         */
+
+        void tag_table::write(const std::vector<gr::tag_t> &tags, uint64_t first, uint64_t count, size_t item_size, size_t lead_bytes, std::vector<char> &out){
+
+            out.clear();
+            d_positions.clear();
+            d_names.clear();
+
+            std::vector<char> entries;
+            int32_t entry_count = 0;
+
+            for(size_t i = 0; i < tags.size(); i++){
+                const gr::tag_t &tag = tags[i];
+
+                if(tag.offset < first || tag.offset >= first + count || pmt::eq(tag.key, d_index_key))
+                    continue;
+
+                std::string value;
+                try{
+                    value = pmt::serialize_str(tag.value);
+                }
+                catch(...){
+                    std::cout << "ERROR: Dropping a stream tag whose value cannot be serialized" << std::endl;
+                    continue;
+                }
+
+                // Position of the key in this table's key list; symbols are interned, so a key is named only the first time it shows up
+                std::map<pmt::pmt_t, int32_t>::iterator it = d_positions.find(tag.key);
+                int32_t key;
+                if(it != d_positions.end()){
+                    key = it->second;
+                }
+                else{
+                    key = (int32_t)d_names.size();
+                    d_positions[tag.key] = key;
+                    d_names.push_back(pmt::symbol_to_string(tag.key));
+                }
+
+                append_int32(entries, (int32_t)(lead_bytes + (tag.offset - first) * item_size));
+                append_int32(entries, key);
+                append_int32(entries, (int32_t)value.size());
+                entries.insert(entries.end(), value.begin(), value.end());
+                entry_count++;
+            }
+
+            if(entry_count == 0)
+                return;
+
+            append_int32(out, (int32_t)d_names.size());
+            for(size_t k = 0; k < d_names.size(); k++){
+                append_int32(out, (int32_t)d_names[k].size());
+                out.insert(out.end(), d_names[k].begin(), d_names[k].end());
+            }
+
+            append_int32(out, entry_count);
+            out.insert(out.end(), entries.begin(), entries.end());
+        }
+
+        /*!
+         *  Parse a tag table. Anything behind the last tag (the padding) is ignored.
+         *
+         *  @param table The table; NULL if the segment has none.
+         *  @param size The size of the table in bytes.
+         *  @param tags The tags; their offsets are in bytes from the start of the data field.
+         *  @return bool False if the table is malformed; the tags parsed up to there are kept.
+         */
+
+        bool tag_table::read(const char *table, size_t size, std::vector<gr::tag_t> &tags){
+
+            tags.clear();
+
+            if(table == NULL || size < 8)
+                return true; // No table
+
+            const char *p = table;
+            const char *end = table + size;
+            std::vector<pmt::pmt_t> keys;
+
+            int32_t key_count = get_int32(p);
+            p += 4;
+
+            for(int32_t k = 0; k < key_count; k++){
+                if(end - p < 4)
+                    return false;
+                int32_t length = get_int32(p);
+                p += 4;
+                if(length < 0 || end - p < length)
+                    return false;
+                keys.push_back(intern(std::string(p, length)));
+                p += length;
+            }
+
+            if(end - p < 4)
+                return false;
+            int32_t tag_count = get_int32(p);
+            p += 4;
+
+            for(int32_t i = 0; i < tag_count; i++){
+                if(end - p < 12)
+                    return false;
+
+                int32_t offset = get_int32(p);
+                int32_t key = get_int32(p + 4);
+                int32_t length = get_int32(p + 8);
+                p += 12;
+
+                if(offset < 0 || key < 0 || key >= (int32_t)keys.size() || length < 0 || end - p < length)
+                    return false;
+
+                gr::tag_t tag;
+                tag.offset = offset;
+                tag.key = keys[key];
+                try{
+                    tag.value = pmt::deserialize_str(std::string(p, length));
+                }
+                catch(...){
+                    return false;
+                }
+                p += length;
+
+                tags.push_back(tag);
+            }
+
+            return true;
+        }
+
+    } /* namespace router */
+} /* namespace gr */
@@ -0,0 +1,108 @@
+/* -*- c++ -*- */
+/*
+ *  Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ Stream tags travel with their segment in a tag table, right behind the data field (see segment_traits.h).
+ The table is in wire order (see wire_format.h), so the routers pass it through untouched.
+
+ Format of the tag table
+ |
+ int32 < key count > -- K
+ K * { int32 < length >, < name > } -- the keys used by the tags of this segment
+ int32 < tag count > -- N
+ N * { int32 < offset >, int32 < key >, int32 < length >, < value > } -- offset in bytes from the start of the data field,
+                                                                       key as a position in the key list, value serialized by pmt
+ |
+
+ A segment without tags has no table. A table is padded with zeros to whole storage items.
+ The index tags ("i") are never in the table; the index travels in the segment header.
+ */
+
+#ifndef INCLUDED_ROUTER_TAG_TABLE_H
+#define INCLUDED_ROUTER_TAG_TABLE_H
+
+#include "segment_traits.h"
+#include <gnuradio/tags.h>
+#include <pmt/pmt.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace gr {
+    namespace router {
+
+        /*!
+         *  Writes and reads the tag tables of one block. The keys are interned once per block, so the
+         *  blocks look up a key by its name only the first time they see it.
+         */
+
+        class tag_table
+        {
+        public:
+            tag_table();
+
+            // The key of the index tags
+            const pmt::pmt_t& index_key() const { return d_index_key; }
+
+            // The key of the tags that mark a shed segment
+            const pmt::pmt_t& gap_key() const { return d_gap_key; }
+
+            // Serialize the tags of samples [first, first + count) to out; empty if there are none
+            void write(const std::vector<gr::tag_t> &tags, uint64_t first, uint64_t count, size_t item_size, size_t lead_bytes, std::vector<char> &out);
+
+            // Parse a table; the offsets of the tags are in bytes from the start of the data field. False if the table is malformed
+            bool read(const char *table, size_t size, std::vector<gr::tag_t> &tags);
+
+        private:
+            pmt::pmt_t d_index_key;
+            pmt::pmt_t d_gap_key;
+
+            std::map<std::string, pmt::pmt_t> d_keys; // Keys read so far, by name
+            std::map<pmt::pmt_t, int32_t> d_positions; // Keys of the table being written, by symbol: their position in its key list
+            std::vector<std::string> d_names; // Their names, by position
+
+            pmt::pmt_t intern(const std::string &name);
+        };
+
+        /// Append a tag table behind the data field of a segment
+        template <class S>
+        void append_tag_table(std::vector<S> &segment, const std::vector<char> &table)
+        {
+            if(table.empty())
+                return;
+
+            size_t at = segment.size();
+            segment.resize(at + (table.size() + sizeof(S) - 1) / sizeof(S), 0);
+            memcpy(&segment[at], &table[0], table.size());
+        }
+
+        /// The tag table of a segment (and its size in bytes; 0 if it has none)
+        template <class S>
+        const char* segment_tag_table(const std::vector<S> &segment, size_t &size)
+        {
+            size_t start = segment_traits<S>::header_items + (size_t)segment_traits<S>::size(segment);
+            size = (segment.size() > start) ? (segment.size() - start) * sizeof(S) : 0;
+            return (size > 0) ? (const char*)&segment[start] : NULL;
+        }
+
+    } // namespace router
+} // namespace gr
+
+#endif /* INCLUDED_ROUTER_TAG_TABLE_H */
@@ -0,0 +1,174 @@
+/* -*- c++ -*- */
+/*
+ *  Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "uring.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+namespace gr {
+    namespace router {
+        
+        static int uring_setup(unsigned entries, struct io_uring_params *p){
+            return (int)syscall(__NR_io_uring_setup, entries, p);
+        }
+        
+        static int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags){
+            return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+        }
+        
+        static int uring_register(int fd, unsigned opcode, const void *arg, unsigned nr_args){
+            return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+        }
+        
+        uring::uring()
+        : d_fd(-1), d_sq_map(MAP_FAILED), d_sq_map_size(0), d_sqes((struct io_uring_sqe *)MAP_FAILED), d_sqes_size(0),
+          d_sq_entries(0), d_sq_local_tail(0), d_sq_submitted(0), d_cq_map(MAP_FAILED), d_cq_map_size(0)
+        {
+        }
+        
+        uring::~uring()
+        {
+            if(d_sqes != MAP_FAILED)
+                munmap(d_sqes, d_sqes_size);
+            if(d_cq_map != MAP_FAILED && d_cq_map != d_sq_map)
+                munmap(d_cq_map, d_cq_map_size);
+            if(d_sq_map != MAP_FAILED)
+                munmap(d_sq_map, d_sq_map_size);
+            if(d_fd >= 0)
+                close(d_fd); // Cancels whatever is still in flight
+        }
+        
+        /*!
+         *  Create the ring and map its queues.
+         *
+         *  @param entries The number of submission entries (the completion queue is twice as long).
+         *  @return True if the ring is ready.
+         */
+        
+        bool uring::setup(unsigned entries){
+            
+            struct io_uring_params p;
+            memset(&p, 0, sizeof(p));
+            
+            d_fd = uring_setup(entries, &p);
+            if(d_fd < 0)
+                return false;
+            
+            d_sq_map_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+            d_cq_map_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+            
+            // Both rings live in one mapping on kernels that can do it
+            if(p.features & IORING_FEAT_SINGLE_MMAP){
+                if(d_cq_map_size > d_sq_map_size)
+                    d_sq_map_size = d_cq_map_size;
+                d_cq_map_size = d_sq_map_size;
+            }
+            
+            d_sq_map = mmap(NULL, d_sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, d_fd, IORING_OFF_SQ_RING);
+            if(d_sq_map == MAP_FAILED)
+                return false;
+            
+            if(p.features & IORING_FEAT_SINGLE_MMAP)
+                d_cq_map = d_sq_map;
+            else{
+                d_cq_map = mmap(NULL, d_cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, d_fd, IORING_OFF_CQ_RING);
+                if(d_cq_map == MAP_FAILED)
+                    return false;
+            }
+            
+            d_sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+            d_sqes = (struct io_uring_sqe *)mmap(NULL, d_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, d_fd, IORING_OFF_SQES);
+            if(d_sqes == MAP_FAILED)
+                return false;
+            
+            char *sq = (char *)d_sq_map;
+            d_sq_head = (unsigned *)(sq + p.sq_off.head);
+            d_sq_tail = (unsigned *)(sq + p.sq_off.tail);
+            d_sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+            d_sq_array = (unsigned *)(sq + p.sq_off.array);
+            d_sq_entries = p.sq_entries;
+            d_sq_local_tail = d_sq_submitted = *d_sq_tail;
+            
+            char *cq = (char *)d_cq_map;
+            d_cq_head = (unsigned *)(cq + p.cq_off.head);
+            d_cq_tail = (unsigned *)(cq + p.cq_off.tail);
+            d_cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+            d_cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+            
+            return true;
+        }
+        
+        bool uring::register_buffers(const struct iovec *buffers, unsigned count){
+            return uring_register(d_fd, IORING_REGISTER_BUFFERS, buffers, count) == 0;
+        }
+        
+        struct io_uring_sqe* uring::get_sqe(){
+            
+            unsigned head = __atomic_load_n(d_sq_head, __ATOMIC_ACQUIRE);
+            if(d_sq_local_tail - head >= d_sq_entries)
+                return NULL;
+            
+            unsigned slot = d_sq_local_tail & *d_sq_mask;
+            struct io_uring_sqe *sqe = &d_sqes[slot];
+            memset(sqe, 0, sizeof(*sqe));
+            
+            d_sq_array[slot] = slot;
+            d_sq_local_tail++;
+            return sqe;
+        }
+        
+        /*!
+         *  Publish the filled submission entries, and enter the kernel to submit them and wait for completions.
+         *
+         *  @param wait_for The number of completions to wait for (0 only submits).
+         *  @return The number of entries submitted; -errno on error (-EINTR if a signal came in first).
+         */
+        
+        int uring::submit_and_wait(unsigned wait_for){
+            
+            unsigned to_submit = d_sq_local_tail - d_sq_submitted;
+            __atomic_store_n(d_sq_tail, d_sq_local_tail, __ATOMIC_RELEASE);
+            
+            int r = uring_enter(d_fd, to_submit, wait_for, (wait_for > 0) ? IORING_ENTER_GETEVENTS : 0);
+            if(r < 0)
+                return -errno;
+            
+            d_sq_submitted += r;
+            return r;
+        }
+        
+        struct io_uring_cqe* uring::next_cqe(){
+            
+            unsigned head = *d_cq_head;
+            if(head == __atomic_load_n(d_cq_tail, __ATOMIC_ACQUIRE))
+                return NULL;
+            
+            return &d_cqes[head & *d_cq_mask];
+        }
+        
+        void uring::cqe_seen(){
+            __atomic_store_n(d_cq_head, *d_cq_head + 1, __ATOMIC_RELEASE);
+        }
+        
+    } /* namespace router */
+} /* namespace gr */
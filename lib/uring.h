@@ -0,0 +1,85 @@
+/* -*- c++ -*- */
+/*
+ *  Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_ROUTER_URING_H
+#define INCLUDED_ROUTER_URING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+/*
+ A minimal io_uring, set up with the raw system calls so that liburing is not a dependency.
+
+ One thread owns the ring: it fills submission entries with get_sqe(), hands them to the
+ kernel with submit_and_wait(), and reaps the completions with next_cqe() / cqe_seen().
+ */
+
+namespace gr {
+    namespace router {
+        
+        class uring {
+        public:
+            uring();
+            ~uring();
+            
+            // Create the ring; false if the kernel has no io_uring (or it is not allowed)
+            bool setup(unsigned entries);
+            
+            // Register buffers for IORING_OP_READ_FIXED; false if the kernel refused (e.g. RLIMIT_MEMLOCK)
+            bool register_buffers(const struct iovec *buffers, unsigned count);
+            
+            // Next free submission entry, cleared; NULL if the submission queue is full
+            struct io_uring_sqe* get_sqe();
+            
+            // Submit the entries filled since the last call, and wait for at least wait_for completions
+            int submit_and_wait(unsigned wait_for);
+            
+            // Oldest completion that has not been seen yet; NULL if there is none
+            struct io_uring_cqe* next_cqe();
+            
+            // Hand the oldest completion back to the kernel
+            void cqe_seen();
+            
+        private:
+            int d_fd;
+            
+            // Submission ring
+            void *d_sq_map;
+            size_t d_sq_map_size;
+            unsigned *d_sq_head, *d_sq_tail, *d_sq_mask, *d_sq_array;
+            struct io_uring_sqe *d_sqes;
+            size_t d_sqes_size;
+            unsigned d_sq_entries;
+            unsigned d_sq_local_tail; // Entries filled, not all of them submitted yet
+            unsigned d_sq_submitted;
+            
+            // Completion ring
+            void *d_cq_map;
+            size_t d_cq_map_size;
+            unsigned *d_cq_head, *d_cq_tail, *d_cq_mask;
+            struct io_uring_cqe *d_cqes;
+        };
+        
+    } // namespace router
+} // namespace gr
+
+#endif /* INCLUDED_ROUTER_URING_H */
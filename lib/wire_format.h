@@ -0,0 +1,125 @@
+/* -*- c++ -*- */
+/*
+ *  Written by Tommy Tracy II (University of Virginia HPLP) 2014
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ Byte order of the wire protocol
+
+ Every multi-byte value on a router link is little-endian: the float headers, the float samples,
+ the int16 samples of CODEC_SC16, the sizes and the weights. Floats are IEEE-754 single precision.
+
+ The data field of a result holds samples of a type only the flow graphs know. The root proposes
+ the size of its words in the codec negotiation (connection_options::result_word_size: 1 for bytes,
+ 2 for shorts, 4 for floats and complex floats), and both ends convert the data field word by word.
+
+ On little-endian hosts all of these helpers are plain copies (and the root sends float segments
+ straight from the queue); big-endian hosts swap with the vectorized kernels.
+ */
+
+#ifndef INCLUDED_ROUTER_WIRE_FORMAT_H
+#define INCLUDED_ROUTER_WIRE_FORMAT_H
+
+#include "kernels.h"
+#include <stdint.h>
+#include <string.h>
+
+#ifndef ROUTER_WIRE_SWAP
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define ROUTER_WIRE_SWAP 1 // Host is big-endian; swap every value to and from the wire
+#else
+#define ROUTER_WIRE_SWAP 0
+#endif
+#endif
+
+namespace gr {
+    namespace router {
+        
+        static inline uint32_t wire_swap32(uint32_t value){
+            if(!ROUTER_WIRE_SWAP)
+                return value;
+            return (value >> 24) | ((value >> 8) & 0xff00) | ((value << 8) & 0xff0000) | (value << 24);
+        }
+        
+        /// Write a 32-bit int to the wire buffer at p
+        static inline void put_int32(char *p, int32_t value){
+            uint32_t bits = wire_swap32((uint32_t)value);
+            memcpy(p, &bits, 4);
+        }
+        
+        /// Read a 32-bit int from the wire buffer at p
+        static inline int32_t get_int32(const char *p){
+            uint32_t bits;
+            memcpy(&bits, p, 4);
+            return (int32_t)wire_swap32(bits);
+        }
+        
+        /// Write a float to the wire buffer at p
+        static inline void put_float(char *p, float value){
+            uint32_t bits;
+            memcpy(&bits, &value, 4);
+            bits = wire_swap32(bits);
+            memcpy(p, &bits, 4);
+        }
+        
+        /// Read a float from the wire buffer at p
+        static inline float get_float(const char *p){
+            uint32_t bits;
+            memcpy(&bits, p, 4);
+            bits = wire_swap32(bits);
+            float value;
+            memcpy(&value, &bits, 4);
+            return value;
+        }
+        
+        /// Copy n host floats to the wire buffer at out
+        static inline void floats_to_wire(const float *in, char *out, int n){
+            if(ROUTER_WIRE_SWAP)
+                byteswap32(in, out, n);
+            else
+                memcpy(out, in, n * sizeof(float));
+        }
+        
+        /// Copy n floats from the wire buffer at in to host floats
+        static inline void floats_from_wire(const char *in, float *out, int n){
+            if(ROUTER_WIRE_SWAP)
+                byteswap32(in, out, n);
+            else
+                memcpy(out, in, n * sizeof(float));
+        }
+        
+        /// Convert n int16 values between host and wire order, in place (the conversion is the same both ways)
+        static inline void int16s_wire_order(void *buffer, int n){
+            if(ROUTER_WIRE_SWAP)
+                byteswap16(buffer, buffer, n);
+        }
+        
+        /// Convert the words of a result data field of size bytes between host and wire order, in place; words of 1 byte (or of a size without a swap) stay as they are
+        static inline void words_wire_order(void *buffer, int size, int word_size){
+            if(!ROUTER_WIRE_SWAP)
+                return;
+            if(word_size == 2)
+                byteswap16(buffer, buffer, size / 2);
+            else if(word_size == 4)
+                byteswap32(buffer, buffer, size / 4);
+        }
+        
+    } // namespace router
+} // namespace gr
+
+#endif /* INCLUDED_ROUTER_WIRE_FORMAT_H */
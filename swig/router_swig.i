@@ -8,6 +8,8 @@
 %include "router_swig_doc.i"
 
 %{
+#include "router/connection_options.h"
+#include "router/scheduler_options.h"
 #include "router/child.h"
 #include "router/root.h"
 #include "router/queue_sink.h"
@@ -17,9 +19,13 @@
 #include "router/throughput_sink.h"
 #include "router/queue_sink_byte.h"
 #include "router/queue_source_byte.h"
+#include "router/queue_sink_typed.h"
+#include "router/queue_source_typed.h"
 %}
 
 
+%include "router/connection_options.h"
+%include "router/scheduler_options.h"
 %include "router/child.h"
 GR_SWIG_BLOCK_MAGIC2(router, child);
 %include "router/root.h"
@@ -38,3 +44,22 @@ GR_SWIG_BLOCK_MAGIC2(router, throughput_sink);
 GR_SWIG_BLOCK_MAGIC2(router, queue_sink_byte);
 %include "router/queue_source_byte.h"
 GR_SWIG_BLOCK_MAGIC2(router, queue_source_byte);
+
+%include "router/queue_sink_typed.h"
+%template(queue_sink_c) gr::router::queue_sink_typed<gr_complex>;
+GR_SWIG_BLOCK_MAGIC2(router, queue_sink_c);
+%template(queue_sink_f) gr::router::queue_sink_typed<float>;
+GR_SWIG_BLOCK_MAGIC2(router, queue_sink_f);
+%template(queue_sink_s) gr::router::queue_sink_typed<short>;
+GR_SWIG_BLOCK_MAGIC2(router, queue_sink_s);
+%template(queue_sink_b) gr::router::queue_sink_typed<signed char>;
+GR_SWIG_BLOCK_MAGIC2(router, queue_sink_b);
+%include "router/queue_source_typed.h"
+%template(queue_source_c) gr::router::queue_source_typed<gr_complex>;
+GR_SWIG_BLOCK_MAGIC2(router, queue_source_c);
+%template(queue_source_f) gr::router::queue_source_typed<float>;
+GR_SWIG_BLOCK_MAGIC2(router, queue_source_f);
+%template(queue_source_s) gr::router::queue_source_typed<short>;
+GR_SWIG_BLOCK_MAGIC2(router, queue_source_s);
+%template(queue_source_b) gr::router::queue_source_typed<signed char>;
+GR_SWIG_BLOCK_MAGIC2(router, queue_source_b);